@@ -4,12 +4,13 @@
 #include "config.h"
 #include "util.h"
 #include "layouts.h"
+#include "winmap.h"
 
 void drawbar(Monitor* m) {
     int x, w, sw = 0, tw, mw, ew = 0;
     int boxs = drw->fonts->h / 9;
     int boxw = drw->fonts->h / 6 + 2;
-    unsigned int i, occ = 0, urg = 0, n = 0;
+    unsigned int i, occ = m->occ, urg = m->urg, n = 0;
     Client* c;
 
     /* draw status first so it can be overdrawn by tags later */
@@ -19,14 +20,9 @@ void drawbar(Monitor* m) {
         drw_text(drw, m->ww - sw, 0, sw, bh, 0, stext, 0);
     }
 
-    // Find out on which tags are windows
-    for (c = m->clients; c; c = c->next) {
+    for (c = m->clients; c; c = c->next)
         if (ISVISIBLE(c))
             n++;
-        occ |= c->tags;
-        if (c->isurgent)
-            urg |= c->tags;
-    }
     // Draw tags
     x = 0;
     for (i = 0; i < ntags; i++) {
@@ -51,14 +47,14 @@ void drawbar(Monitor* m) {
     // Draw window names
     if ((w = m->ww - sw - x) > bh) {
         if (n > 0) {
-            tw = TEXTW(m->sel->name) + lrpad;
+            tw = TEXTW(m->sel->cold->name) + lrpad;
             mw = (tw >= w || n == 1) ? 0 : (w - tw - TEXTW(separator)) / (n - 1);
 
             i = 0;
             for (c = m->clients; c; c = c->next) {
                 if (!ISVISIBLE(c) || c == m->sel)
                     continue;
-                tw = TEXTW(c->name);
+                tw = TEXTW(c->cold->name);
                 if (tw < mw)
                     ew += (mw - tw - TEXTW(separator));
                 else
@@ -71,11 +67,11 @@ void drawbar(Monitor* m) {
             for (c = m->clients; c; c = c->next) {
                 if (!ISVISIBLE(c))
                     continue;
-                tw = MIN(m->sel == c || n == 1 ? w : mw, TEXTW(c->name));
+                tw = MIN(m->sel == c || n == 1 ? w : mw, TEXTW(c->cold->name));
 
                 drw_setscheme(drw, scheme[m->sel == c ? SchemeSel : (c->hidden ? SchemeHidden : SchemeNotSel)]);
                 if (tw > 0) /* trap special handling of 0 in drw_text */
-                    drw_text(drw, x, 0, tw, bh, lrpad / 2, c->name, 0);
+                    drw_text(drw, x, 0, tw, bh, lrpad / 2, c->cold->name, 0);
                 if (c->isfloating)
                     drw_rect(drw, x + boxs, boxs, boxw, boxw, c->isfixed, 0);
 
@@ -100,13 +96,6 @@ void drawbar(Monitor* m) {
     drw_map(drw, m->barwin, 0, 0, m->ww, bh);
 }
 
-void drawbars(void) {
-    Monitor* m;
-
-    for (m = mons; m; m = m->next)
-        drawbar(m);
-}
-
 void togglebar(const Arg* arg) {
     selmon->showbar = !selmon->showbar;
     updatebarpos(selmon);
@@ -131,10 +120,12 @@ void updatebars(void) {
         XDefineCursor(dpy, m->barwin, cursor[CurNormal]->cursor);
         XMapRaised(dpy, m->barwin);
         XSetClassHint(dpy, m->barwin, &ch);
+        winmap_add(m->barwin, NULL, m);
     }
 }
 
 void updatebarpos(Monitor* m) {
+    m->staletags |= TAGMASK; /* the window area of every tag */
     m->wy = m->my;
     m->wh = m->mh;
     if (m->showbar) {
@@ -151,7 +142,7 @@ void bar_closewindow(const Arg* arg) {
         return;
     unsigned int newtags = client->tags ^ selmon->tagset[selmon->seltags];
     if (newtags != 0) {
-        client->tags = newtags;
+        settags(client, newtags);
         focus(NULL);
         arrange(selmon);
     } else {
@@ -168,5 +159,5 @@ void bar_focusclient(const Arg* arg) {
     focus(c);
     restack(selmon);
     if (c->isfloating || selmon->pertag->layout[selmon->pertag->curtag]->arrange == &layout_float)
-        XRaiseWindow(dpy, c->win);
+        raiseclient(c);
 }
@@ -4,7 +4,6 @@ typedef struct Monitor Monitor;
 typedef union Arg Arg;
 
 void drawbar(Monitor* m);
-void drawbars(void);
 void togglebar(const Arg* arg);
 void updatebars(void);
 void updatebarpos(Monitor* m);
@@ -0,0 +1,169 @@
+/* Times the layouts of tiling.c and checks what they compute against the
+ * golden files in bench/golden, no X server involved.
+ *
+ * usage: layouts [-u] golden-dir
+ *
+ * -u rewrites the golden files from the current layouts instead, to be
+ * reviewed like any other change. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../tiling.h"
+
+#define LENGTH(X) (sizeof X / sizeof X[0])
+
+static const struct {
+    const char* name;
+    TileFunc func;
+} layouts[] = {
+    { "tile", tilerects },
+    { "centeredmaster", centeredmasterrects },
+    { "centeredfloatingmaster", centeredfloatingmasterrects },
+    { "dwindle", dwindlerects },
+    { "monocle", monoclerects },
+    { "deck", deckrects },
+    { "scroll", scrollrects },
+};
+
+/* client counts timed, and checked against the golden files */
+static const unsigned int timed[]   = { 1, 10, 100, 1000, 10000 };
+static const unsigned int checked[] = { 1, 2, 3, 4, 5, 7, 10, 25 };
+
+static unsigned int seed;
+
+/* the same sequence everywhere, unlike rand() */
+static unsigned int next(void) {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) & 0x7fff;
+}
+
+/* a 1920x1080 screen below a 20 pixel bar, like the defaults in config.c */
+static TileParams params(int nmaster) {
+    TileParams p = {
+        .mw = 1920, .mh = 1080,
+        .wx = 0, .wy = 20, .ww = 1920, .wh = 1060,
+        .mfact = 0.55, .nmaster = nmaster,
+        .gappx = 6, .borderpx = 1,
+        .minsize = 20, .sizehints = 1
+    };
+
+    return p;
+}
+
+/* clients with varied cfacts, some with the size hints of terminals */
+static void makeclients(TileClient* c, unsigned int n) {
+    unsigned int i;
+
+    seed = n;
+    memset(c, 0, n * sizeof(TileClient));
+    for (i = 0; i < n; i++) {
+        c[i].cfact = next() % 4 ? 1.0 : 0.25 * (1 + next() % 8);
+        c[i].bw    = 1;
+        if (next() % 3 == 0) {
+            c[i].basew = c[i].minw = 2 + next() % 10;
+            c[i].baseh = c[i].minh = 2 + next() % 10;
+            c[i].incw  = 6 + next() % 4;
+            c[i].inch  = 12 + next() % 6;
+        }
+        if (next() % 8 == 0)
+            c[i].maxw = 400 + next() % 400;
+    }
+}
+
+static int golden(const char* dir, unsigned int l, int update) {
+    TileClient c[25];
+    TileRect r[25];
+    TileParams p;
+    FILE* f;
+    char path[4096], want[128], got[128];
+    unsigned int i, k;
+    int nmaster, line = 0;
+
+    snprintf(path, sizeof path, "%s/%s.txt", dir, layouts[l].name);
+    if (!(f = fopen(path, update ? "w" : "r"))) {
+        perror(path);
+        return 0;
+    }
+    for (nmaster = 0; nmaster < 4; nmaster++) {
+        for (k = 0; k < LENGTH(checked); k++) {
+            p = params(nmaster);
+            makeclients(c, checked[k]);
+            layouts[l].func(&p, c, r, checked[k]);
+            for (i = 0; i < checked[k]; i++) {
+                snprintf(got, sizeof got, "n=%u nmaster=%d %u: %d %d %d %d %d\n",
+                    checked[k], nmaster, i, r[i].x, r[i].y, r[i].w, r[i].h, r[i].bw);
+                line++;
+                if (update)
+                    fputs(got, f);
+                else if (!fgets(want, sizeof want, f) || strcmp(want, got)) {
+                    fprintf(stderr, "%s:%d: got %s", path, line, got);
+                    fclose(f);
+                    return 0;
+                }
+            }
+        }
+    }
+    if (!update && fgets(want, sizeof want, f)) {
+        fprintf(stderr, "%s:%d: unexpected %s", path, line + 1, want);
+        fclose(f);
+        return 0;
+    }
+    fclose(f);
+    return 1;
+}
+
+static void timelayout(unsigned int l) {
+    TileClient* c;
+    TileRect* r;
+    TileParams p = params(1);
+    struct timespec start, end;
+    unsigned int i, k, reps;
+    double ns;
+
+    printf("%-24s", layouts[l].name);
+    for (k = 0; k < LENGTH(timed); k++) {
+        c = calloc(timed[k], sizeof(TileClient));
+        r = calloc(timed[k], sizeof(TileRect));
+        if (!c || !r) {
+            perror("calloc");
+            exit(1);
+        }
+        makeclients(c, timed[k]);
+        reps = 2000000 / timed[k];
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (i = 0; i < reps; i++)
+            layouts[l].func(&p, c, r, timed[k]);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        ns = ((end.tv_sec - start.tv_sec) * 1e9 + end.tv_nsec - start.tv_nsec) / reps;
+        printf(" %12.0f", ns);
+        free(c);
+        free(r);
+    }
+    putchar('\n');
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int l, k;
+    int update = 0, ok = 1;
+
+    if (argc == 3 && !strcmp(argv[1], "-u"))
+        update = 1;
+    else if (argc != 2) {
+        fputs("usage: layouts [-u] golden-dir\n", stderr);
+        return 1;
+    }
+    for (l = 0; l < LENGTH(layouts); l++)
+        ok &= golden(argv[argc - 1], l, update);
+    if (!ok)
+        return 1;
+    printf("%-24s", "ns per arrange, clients");
+    for (k = 0; k < LENGTH(timed); k++)
+        printf(" %12u", timed[k]);
+    putchar('\n');
+    for (l = 0; l < LENGTH(layouts); l++)
+        timelayout(l);
+    return 0;
+}
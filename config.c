@@ -70,6 +70,9 @@ const int nrules = LENGTH(rules);
 const float mfact     = 0.55; /* factor of master area size [0.05..0.95] */
 const int nmaster     = 1;    /* number of clients in master area */
 const int resizehints = 1;    /* 1 means respect size hints in tiled resizals */
+const int hideunmap   = 0;    /* 1 means unmap hidden clients instead of moving them off-screen */
+const int tagframes   = 0;    /* 1 means keep tiled clients in a container window per tag */
+const int prearrangetags = 2; /* hidden tags per monitor arranged in the background, 0 for none */
 
 const Layout layouts[] = {
 	/* symbol     arrange function */
@@ -80,6 +83,7 @@ const Layout layouts[] = {
 	{ ">M>",      centeredfloatingmaster },
  	{ "[\\]",     dwindle },
 	{ "[D]",      deck },
+	{ "|||",      scroll },
 };
 
 /* key definitions */
@@ -133,6 +137,7 @@ const Key keys[] = {
 	{ MODKEY,                       XK_i,                     setlayout,        {.v = &layouts[4]} },
 	{ MODKEY,                       XK_r,                     setlayout,        {.v = &layouts[5]} },
 	{ MODKEY,                       XK_o,                     setlayout,        {.v = &layouts[6]} },
+	{ MODKEY,                       XK_s,                     setlayout,        {.v = &layouts[7]} },
 	{ MODKEY,                       XK_space,                 togglefloating,   {0} },
 	{ MODKEY|ShiftMask,             XK_f,                     togglefullscr,    {0} },
 	{ MODKEY,                       XK_a,                     setattach,        {.i = -1} },
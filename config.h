@@ -31,6 +31,9 @@ extern const int nrules;
 extern const float mfact;
 extern const int nmaster;
 extern const int resizehints;
+extern const int hideunmap;
+extern const int tagframes;
+extern const int prearrangetags;
 
 extern const Layout layouts[];
 
@@ -14,7 +14,20 @@
  * set the override_redirect flag. Clients are organized in a linked client
  * list on each monitor, the focus history is remembered through a stack list
  * on each monitor. Each client contains a bit array to indicate the tags of a
- * client.
+ * client. Client and bar windows are additionally indexed in a hash table
+ * (winmap.c), which maps event windows to their owner in O(1) time. Clients
+ * are allocated from slabs (pool.c), their rarely used state is kept apart in
+ * ClientCold.
+ *
+ * The properties of a new window are requested in one go over the XCB
+ * connection beneath dpy (props.c) before manage() is called with them.
+ *
+ * Handlers do not lay out, restack or redraw monitors themselves, they only
+ * mark them dirty. The pending work is done once in flushpending() after the
+ * current batch of X events has been handled.
+ *
+ * run() waits with epoll(7) on the X connection, a signalfd for the signals
+ * dwm handles and a timerfd driving the callbacks set with settimeout().
  *
  * Keys and tagging rules are organized as arrays and defined in config.h.
  *
@@ -26,6 +39,9 @@
 #include "layouts.h"
 #include "util.h"
 #include "bar.h"
+#include "winmap.h"
+#include "props.h"
+#include "pool.h"
 
 const char broken[] = "broken";
 char stext[256];
@@ -53,10 +69,30 @@ void (*handler[LASTEvent])(XEvent*) = {
     [UnmapNotify]      = unmapnotify
 };
 Atom wmatom[WMLast], netatom[NetLast];
+unsigned long enterserial = 0;
 int running = 1;
+int epollfd = -1, sigfd = -1, timerfd = -1;
+sigset_t origsigmask;
+Timer timers[MAXTIMERS];
+/* keys[] by keycode, the bindings of keycode k are keybinds[keystart[k]] up to
+ * keybinds[keystart[k + 1]] */
+unsigned int keystart[257];
+const Key** keybinds;
+Stats stats;
+Window *clientwins, *stackingwins; /* managed windows in mapping order, scratch */
+unsigned int nclientwins, clientwinssize; /* unmanaged ones are None until updateclientlist() */
+Client** raisedclients; /* scratch for updateclientlist() */
+unsigned long raises; /* raiseclient() calls */
+unsigned int listsdirty;
+int geomdirty; /* a client was resized since the last commitgeometry() */
+unsigned long clientids; /* Client.id of the last managed client */
+struct timespec viewstart; /* last view() not yet flushed, zero if none */
+unsigned long viewserial;
+Pool clientpool = POOL(Client, 64), coldpool = POOL(ClientCold, 16);
 Cur* cursor[CurLast];
 Clr** scheme;
 Display* dpy;
+xcb_connection_t* xcon;
 Drw* drw;
 Monitor *mons, *selmon;
 Window root, wmcheckwin;
@@ -70,18 +106,16 @@ void applyrules(Client* c) {
     unsigned int i;
     const Rule* r;
     Monitor* m;
-    XClassHint ch = { NULL, NULL };
 
     /* rule matching */
     c->isfloating = 0;
     c->tags       = 0;
-    XGetClassHint(dpy, c->win, &ch);
-    class    = ch.res_class ? ch.res_class : broken;
-    instance = ch.res_name ? ch.res_name : broken;
+    class         = c->cold->class[0] ? c->cold->class : broken;
+    instance      = c->cold->instance[0] ? c->cold->instance : broken;
 
     for (i = 0; i < nrules; i++) {
         r = &rules[i];
-        if ((!r->title || strstr(c->name, r->title))
+        if ((!r->title || strstr(c->cold->name, r->title))
             && (!r->window_class || strstr(class, r->window_class))
             && (!r->instance || strstr(instance, r->instance))) {
             c->isfloating = r->isfloating;
@@ -92,10 +126,6 @@ void applyrules(Client* c) {
                 c->mon = m;
         }
     }
-    if (ch.res_class)
-        XFree(ch.res_class);
-    if (ch.res_name)
-        XFree(ch.res_name);
     c->tags = c->tags & TAGMASK ? c->tags & TAGMASK : (c->mon->tagset[c->mon->seltags] ? c->mon->tagset[c->mon->seltags] : 1);
 }
 
@@ -163,55 +193,124 @@ int applysizehints(Client* c, int* x, int* y, int* w, int* h, int interact) {
     return *x != c->x || *y != c->y || *w != c->w || *h != c->h;
 }
 
+void armtimers(void) {
+    struct itimerspec its = { 0 };
+    int i;
+
+    /* program timerfd for the earliest pending timer, or disarm it */
+    for (i = 0; i < MAXTIMERS; i++)
+        if (timers[i].func
+            && ((!its.it_value.tv_sec && !its.it_value.tv_nsec)
+                || timers[i].due.tv_sec < its.it_value.tv_sec
+                || (timers[i].due.tv_sec == its.it_value.tv_sec && timers[i].due.tv_nsec < its.it_value.tv_nsec)))
+            its.it_value = timers[i].due;
+    timerfd_settime(timerfd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
 void arrange(Monitor* m) {
-    if (m)
-        showhide(m->stack);
-    else
-        for (m = mons; m; m = m->next)
-            showhide(m->stack);
-    if (m) {
-        arrangemon(m);
-        restack(m);
-    } else
-        for (m = mons; m; m = m->next)
-            arrangemon(m);
+    markdirty(m, DirtyLayout);
 }
 
 void arrangemon(Monitor* m) {
-    strncpy(m->ltsymbol, m->pertag->layout[m->pertag->curtag]->symbol, sizeof m->ltsymbol);
-    if (m->pertag->layout[m->pertag->curtag]->arrange)
-        m->pertag->layout[m->pertag->curtag]->arrange(m);
+    const Layout* l    = m->pertag->layout[m->pertag->curtag];
+    LayoutCache* cache = &m->pertag->cache[m->pertag->curtag];
+
+    stats.arranges++;
+    updatetiled(m);
+    strncpy(m->ltsymbol, l->symbol, sizeof m->ltsymbol);
+    if (!l->arrange)
+        return;
+    /* the floating layout restores geometry and scroll follows the selection,
+     * neither of which is part of the key */
+    if (l->arrange == layout_float || l->arrange == scroll)
+        l->arrange(m);
+    else if (loadlayout(m, cache))
+        stats.cachedlayouts++;
+    else {
+        l->arrange(m);
+        savelayout(m, cache);
+    }
+}
+
+/* Arranges tag t, an index into m->pertag, as if it was viewed alone. */
+void arrangetag(Monitor* m, unsigned int t) {
+    unsigned int tagset = m->tagset[m->seltags], curtag = m->pertag->curtag;
+    int nmaster = m->nmaster;
+    float mfact = m->mfact;
+    char ltsymbol[sizeof m->ltsymbol];
+    Client* c;
+
+    memcpy(ltsymbol, m->ltsymbol, sizeof ltsymbol);
+    m->tagset[m->seltags] = 1 << (t - 1);
+    m->pertag->curtag     = t;
+    m->nmaster            = m->pertag->nmasters[t];
+    m->mfact              = m->pertag->mfacts[t];
+    arrangemon(m);
+    markoccluded(m); /* as commitgeometry() would when t is viewed */
+    for (c = m->clients; c; c = c->next)
+        if (ISVISIBLE(c) && !c->occluded)
+            commitclient(c);
+    m->tagset[m->seltags] = tagset;
+    m->pertag->curtag     = curtag;
+    m->nmaster            = nmaster;
+    m->mfact              = mfact;
+    memcpy(m->ltsymbol, ltsymbol, sizeof ltsymbol);
+    updatetiled(m); /* m->tiled is the view's again */
 }
 
 void attach(Client* c) {
-    Client* prev;
+    Monitor* m   = c->mon;
+    Client *prev = NULL, *t;
     int i;
-    int attachmode = nexttiled(selmon->clients) ? selmon->attachmode : AttachFront;
-    switch (attachmode) {
-    case AttachFront:
-        c->next         = c->mon->clients;
-        c->mon->clients = c;
-        break;
-    case AttachStack:
-        i = 1;
-        for (prev = nexttiled(selmon->clients); prev->next && i < selmon->nmaster; prev = nexttiled(prev->next)) {
-            i++;
-        }
-        c->next    = prev->next;
-        prev->next = c;
+
+    switch (m->attachmode) {
+    case AttachStack: /* after the last master */
+        if ((prev = nexttiled(m->clients)))
+            for (i = 1; i < m->nmaster && (t = nexttiled(prev->next)); i++)
+                prev = t;
         break;
-    case AttachEnd:
-        for (prev = nexttiled(selmon->clients); nexttiled(prev->next); prev = nexttiled(prev->next))
-            ;
-        c->next    = prev->next;
-        prev->next = c;
+    case AttachEnd: /* after the last tiled client */
+        if (!(m->dirty & DirtyLayout))
+            prev = m->tiledtail;
+        else
+            for (prev = m->tail; prev && (prev->isfloating || !ISVISIBLE(prev) || ISHIDDEN(prev)); prev = prev->prev)
+                ;
         break;
     }
+    /* AttachFront, or no tiled client to attach behind */
+    attachbefore(c, prev ? prev->next : m->clients);
+}
+
+/* inserts c into the client list of c->mon in front of next, at the end if
+ * next is NULL */
+void attachbefore(Client* c, Client* next) {
+    Monitor* m = c->mon;
+
+    c->next = next;
+    c->prev = next ? next->prev : m->tail;
+    if (c->prev)
+        c->prev->next = c;
+    else
+        m->clients = c;
+    if (next)
+        next->prev = c;
+    else
+        m->tail = c;
+    counttags(c, 1);
+    m->staletags |= c->tags;
 }
 
 void attachstack(Client* c) {
-    c->snext      = c->mon->stack;
-    c->mon->stack = c;
+    Monitor* m = c->mon;
+
+    listsdirty |= ListStacking;
+    c->sprev = NULL;
+    c->snext = m->stack;
+    if (m->stack)
+        m->stack->sprev = c;
+    else
+        m->stail = c;
+    m->stack = c;
 }
 
 void buttonpress(XEvent* e) {
@@ -252,7 +351,7 @@ void buttonpress(XEvent* e) {
                     if (!ISVISIBLE(c))
                         continue;
                     else
-                        x += TEXTW(c->name) + TEXTW(separator);
+                        x += TEXTW(c->cold->name) + TEXTW(separator);
                 } while (ev->x > x && (c = c->next));
 
                 click = ClkWinTitle;
@@ -263,7 +362,7 @@ void buttonpress(XEvent* e) {
         focus(c);
         restack(selmon);
         if (c->isfloating || selmon->pertag->layout[selmon->pertag->curtag]->arrange == &layout_float)
-            XRaiseWindow(dpy, c->win);
+            raiseclient(c);
         XAllowEvents(dpy, ReplayPointer, CurrentTime);
         click = ClkClientWin;
     }
@@ -277,9 +376,9 @@ void checkotherwm(void) {
     xerrorxlib = XSetErrorHandler(xerrorstart);
     /* this causes an error if some other window manager is running */
     XSelectInput(dpy, DefaultRootWindow(dpy), SubstructureRedirectMask);
-    XSync(dpy, False);
+    xsync();
     XSetErrorHandler(xerror);
-    XSync(dpy, False);
+    xsync();
 }
 
 void cleanup(void) {
@@ -288,10 +387,16 @@ void cleanup(void) {
     size_t i;
 
     view(&a);
+    flushpending();
     for (m = mons; m; m = m->next)
-        while (m->stack)
+        while (m->stack) {
+            /* hidden clients would stay unmapped after we are gone */
+            if (m->stack->iconic)
+                XMapWindow(dpy, m->stack->win);
             unmanage(m->stack, 0);
+        }
     XUngrabKey(dpy, AnyKey, AnyModifier, root);
+    free(keybinds);
     while (mons)
         cleanupmon(mons);
     for (i = 0; i < CurLast; i++)
@@ -299,14 +404,24 @@ void cleanup(void) {
     for (i = 0; i < ncolors; i++)
         free(scheme[i]);
     XDestroyWindow(dpy, wmcheckwin);
+    winmap_free();
+    free(clientwins);
+    free(stackingwins);
+    free(raisedclients);
+    pool_destroy(&clientpool);
+    pool_destroy(&coldpool);
+    close(epollfd);
+    close(sigfd);
+    close(timerfd);
     drw_free(drw);
-    XSync(dpy, False);
+    xsync();
     XSetInputFocus(dpy, PointerRoot, RevertToPointerRoot, CurrentTime);
     XDeleteProperty(dpy, root, netatom[NetActiveWindow]);
 }
 
 void cleanupmon(Monitor* mon) {
     Monitor* m;
+    int i;
 
     if (mon == mons)
         mons = mons->next;
@@ -315,8 +430,17 @@ void cleanupmon(Monitor* mon) {
             ;
         m->next = mon->next;
     }
+    winmap_remove(mon->barwin);
     XUnmapWindow(dpy, mon->barwin);
     XDestroyWindow(dpy, mon->barwin);
+    for (i = 0; i < ntags && mon->frames[i]; i++)
+        XDestroyWindow(dpy, mon->frames[i]);
+    for (i = 0; i < LENGTH(mon->pertag->cache); i++)
+        free(mon->pertag->cache[i].slots);
+    free(mon->pertag);
+    free(mon->tiled);
+    free(mon->tilein);
+    free(mon->tileout);
     free(mon);
 }
 
@@ -337,6 +461,88 @@ void clientmessage(XEvent* e) {
     }
 }
 
+/* Drop events which a later event of the same batch makes redundant: property
+ * changes of the same atom, configure requests of the same window (the later
+ * one inherits the values only set by the earlier one), exposures of the same
+ * window and pointer motion. Another kind of event for the same window in
+ * between keeps the earlier event. Dropped events get type 0. */
+void coalesce(XEvent* evs, int n) {
+    int i, j;
+    Window w;
+
+    for (i = n - 2; i >= 0; i--) {
+        if (evs[i].type != PropertyNotify && evs[i].type != ConfigureRequest
+            && evs[i].type != Expose && evs[i].type != MotionNotify)
+            continue;
+        w = evwindow(&evs[i]);
+        for (j = i + 1; j < n; j++) {
+            if (!evs[j].type || evwindow(&evs[j]) != w)
+                continue;
+            if (mergeevent(&evs[j], &evs[i])) {
+                evs[i].type = 0;
+                break;
+            }
+            if (evs[j].type != evs[i].type || evs[j].type == ConfigureRequest)
+                break;
+        }
+    }
+}
+
+/* Sends the fields of the geometry of c which differ from what the server
+ * was last told. Returns 0 if there were none. A client showhide() moved
+ * off-screen only gets its size, so it stays there. */
+int commitclient(Client* c) {
+    XWindowChanges wc;
+    unsigned int mask = 0;
+
+    if (!c->shown && !c->iconic && !c->frame) {
+        wc.x = c->sent.x;
+        wc.y = c->sent.y;
+    } else {
+        wc.x = c->x - FRAMEX(c);
+        wc.y = c->y - FRAMEY(c);
+    }
+    wc.width        = c->w;
+    wc.height       = c->h;
+    wc.border_width = c->pbw;
+    mask |= wc.x != c->sent.x ? CWX : 0;
+    mask |= wc.y != c->sent.y ? CWY : 0;
+    mask |= wc.width != c->sent.width ? CWWidth : 0;
+    mask |= wc.height != c->sent.height ? CWHeight : 0;
+    mask |= wc.border_width != c->sent.border_width ? CWBorderWidth : 0;
+    if (!mask)
+        return 0;
+    XConfigureWindow(dpy, c->win, mask, &wc);
+    c->sent = wc;
+    stats.configures++;
+    /* the real ConfigureNotify has coordinates relative to the parent, which
+     * are only root ones outside a frame; in one the synthetic event gives
+     * the client its root position (ICCCM 4.1.5) */
+    if (c->frame)
+        configure(c);
+    return 1;
+}
+
+/* Sends the geometry the layouts produced for every shown client, except
+ * for those markoccluded() finds hidden under another; focus() has theirs
+ * sent once they come on top. */
+void commitgeometry(void) {
+    Client* c;
+    Monitor* m;
+
+    geomdirty = 0;
+    for (m = mons; m; m = m->next) {
+        markoccluded(m);
+        for (c = m->stack; c; c = c->snext)
+            if (ISVISIBLE(c) && !ISHIDDEN(c)) {
+                if (c->occluded)
+                    stats.deferred++;
+                else
+                    commitclient(c);
+            }
+    }
+}
+
 void configure(Client* c) {
     XConfigureEvent ce;
 
@@ -348,10 +554,18 @@ void configure(Client* c) {
     ce.y                 = c->y;
     ce.width             = c->w;
     ce.height            = c->h;
-    ce.border_width      = c->bw;
+    ce.border_width      = c->pbw;
+    if (c->occluded) { /* tell what the window is, not what it will be */
+        ce.x            = c->sent.x + FRAMEX(c);
+        ce.y            = c->sent.y + FRAMEY(c);
+        ce.width        = c->sent.width;
+        ce.height       = c->sent.height;
+        ce.border_width = c->sent.border_width;
+    }
     ce.above             = None;
     ce.override_redirect = False;
     XSendEvent(dpy, c->win, False, StructureNotifyMask, (XEvent*)&ce);
+    stats.notifies++;
 }
 
 void configurenotify(XEvent* e) {
@@ -387,9 +601,10 @@ void configurerequest(XEvent* e) {
     XWindowChanges wc;
 
     if ((c = wintoclient(ev->window))) {
-        if (ev->value_mask & CWBorderWidth)
+        if (ev->value_mask & CWBorderWidth) {
             c->bw = ev->border_width;
-        else if (c->isfloating || !selmon->pertag->layout[selmon->pertag->curtag]->arrange) {
+            c->mon->staletags |= c->tags;
+        } else if (c->isfloating || !selmon->pertag->layout[selmon->pertag->curtag]->arrange) {
             m = c->mon;
             if (ev->value_mask & CWX) {
                 c->oldx = c->x;
@@ -411,10 +626,9 @@ void configurerequest(XEvent* e) {
                 c->x = m->mx + (m->mw / 2 - WIDTH(c) / 2); /* center in x direction */
             if ((c->y + c->h) > m->my + m->mh && c->isfloating)
                 c->y = m->my + (m->mh / 2 - HEIGHT(c) / 2); /* center in y direction */
-            if ((ev->value_mask & (CWX | CWY)) && !(ev->value_mask & (CWWidth | CWHeight)))
+            /* the client needs a ConfigureNotify even if nothing changed */
+            if (!ISVISIBLE(c) || !commitclient(c))
                 configure(c);
-            if (ISVISIBLE(c))
-                XMoveResizeWindow(dpy, c->win, c->x, c->y, c->w, c->h);
         } else
             configure(c);
     } else {
@@ -427,7 +641,22 @@ void configurerequest(XEvent* e) {
         wc.stack_mode   = ev->detail;
         XConfigureWindow(dpy, ev->window, ev->value_mask, &wc);
     }
-    XSync(dpy, False);
+}
+
+void counttags(Client* c, int n) {
+    Monitor* m = c->mon;
+    unsigned int i;
+
+    for (i = 0; i < LENGTH(m->nocc); i++) {
+        if (!(c->tags & 1 << i))
+            continue;
+        m->nocc[i] += n;
+        m->occ = m->nocc[i] ? m->occ | 1 << i : m->occ & ~(1 << i);
+        if (!c->isurgent)
+            continue;
+        m->nurg[i] += n;
+        m->urg = m->nurg[i] ? m->urg | 1 << i : m->urg & ~(1 << i);
+    }
 }
 
 Monitor*
@@ -453,10 +682,26 @@ createmon(void) {
     }
 
     m->attachmode = AttachEnd;
+    m->curframe   = m->frameup = -1;
 
     return m;
 }
 
+void decodetextprop(XTextProperty* name, char* text, unsigned int size) {
+    char** list = NULL;
+    int n;
+
+    if (name->encoding == XA_STRING)
+        strncpy(text, (char*)name->value, size - 1);
+    else {
+        if (XmbTextPropertyToTextList(dpy, name, &list, &n) >= Success && n > 0 && *list) {
+            strncpy(text, *list, size - 1);
+            XFreeStringList(list);
+        }
+    }
+    text[size - 1] = '\0';
+}
+
 void destroynotify(XEvent* e) {
     Client* c;
     XDestroyWindowEvent* ev = &e->xdestroywindow;
@@ -466,19 +711,37 @@ void destroynotify(XEvent* e) {
 }
 
 void detach(Client* c) {
-    Client** tc;
+    Monitor* m = c->mon;
 
-    for (tc = &c->mon->clients; *tc && *tc != c; tc = &(*tc)->next)
-        ;
-    *tc = c->next;
+    counttags(c, -1);
+    m->staletags |= c->tags;
+    if (c == m->tiledtail) /* the caller arranges m, which finds the new one */
+        markdirty(m, DirtyLayout);
+    if (c->prev)
+        c->prev->next = c->next;
+    else
+        m->clients = c->next;
+    if (c->next)
+        c->next->prev = c->prev;
+    else
+        m->tail = c->prev;
+    c->prev = c->next = NULL;
 }
 
 void detachstack(Client* c) {
-    Client **tc, *t;
+    Monitor* m = c->mon;
+    Client* t;
 
-    for (tc = &c->mon->stack; *tc && *tc != c; tc = &(*tc)->snext)
-        ;
-    *tc = c->snext;
+    listsdirty |= ListStacking;
+    if (c->sprev)
+        c->sprev->snext = c->snext;
+    else
+        m->stack = c->snext;
+    if (c->snext)
+        c->snext->sprev = c->sprev;
+    else
+        m->stail = c->sprev;
+    c->sprev = c->snext = NULL;
 
     if (c == c->mon->sel) {
         for (t = c->mon->stack; t && (!ISVISIBLE(t) || ISHIDDEN(t)); t = t->snext)
@@ -510,6 +773,8 @@ void enternotify(XEvent* e) {
 
     if ((ev->mode != NotifyNormal || ev->detail == NotifyInferior) && ev->window != root)
         return;
+    if (ev->serial < enterserial)
+        return;
     c = wintoclient(ev->window);
     m = c ? c->mon : wintomon(ev->window);
     if (m != selmon) {
@@ -520,12 +785,84 @@ void enternotify(XEvent* e) {
     focus(c);
 }
 
+/* the window an event is about, which is not always ev->xany.window */
+Window evwindow(XEvent* ev) {
+    switch (ev->type) {
+    case ConfigureRequest:
+        return ev->xconfigurerequest.window;
+    case ConfigureNotify:
+        return ev->xconfigure.window;
+    case CreateNotify:
+        return ev->xcreatewindow.window;
+    case DestroyNotify:
+        return ev->xdestroywindow.window;
+    case MapNotify:
+        return ev->xmap.window;
+    case MapRequest:
+        return ev->xmaprequest.window;
+    case ReparentNotify:
+        return ev->xreparent.window;
+    case UnmapNotify:
+        return ev->xunmap.window;
+    default:
+        return ev->xany.window;
+    }
+}
+
 void expose(XEvent* e) {
     Monitor* m;
     XExposeEvent* ev = &e->xexpose;
 
     if (ev->count == 0 && (m = wintomon(ev->window)))
-        drawbar(m);
+        markdirty(m, DirtyBar);
+}
+
+void flushpending(void) {
+    Monitor* m;
+    int restacked = 0;
+    struct timespec end;
+    unsigned long ns;
+
+    for (m = mons; m; m = m->next)
+        if (m->dirty & DirtyLayout) {
+            arrangemon(m);
+            showhide(m);
+            if (prearrangetags)
+                markstale(m);
+            m->dirty |= DirtyStack | DirtyBar;
+        } else if (m->dirty & DirtyScroll)
+            scrollview(m);
+    if (geomdirty)
+        commitgeometry();
+    for (m = mons; m; m = m->next) {
+        if (m->dirty & DirtyStack) {
+            if (tagframes)
+                stackframe(m);
+            restackmon(m);
+            restacked = 1;
+        }
+        if (m->dirty & DirtyBar)
+            drawbar(m);
+        m->dirty = 0;
+    }
+    /* EnterNotify events caused by moving windows under the pointer carry a
+     * serial below that of the no-op sent after them, enternotify() drops
+     * them; those the server generates later carry the no-op's or above */
+    if (restacked) {
+        enterserial = NextRequest(dpy);
+        XNoOp(dpy);
+    }
+    if (listsdirty)
+        updateclientlist();
+    if (viewstart.tv_sec || viewstart.tv_nsec) {
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        ns = (end.tv_sec - viewstart.tv_sec) * 1000000000UL + end.tv_nsec - viewstart.tv_nsec;
+        stats.views++;
+        stats.viewns += ns;
+        stats.maxviewns = MAX(stats.maxviewns, ns);
+        stats.viewreqs += NextRequest(dpy) - viewserial;
+        viewstart.tv_sec = viewstart.tv_nsec = 0;
+    }
 }
 
 void focus(Client* c) {
@@ -542,12 +879,16 @@ void focus(Client* c) {
         grabbuttons(c, 1);
         XSetWindowBorder(dpy, c->win, scheme[SchemeSel][ColBorder].pixel);
         setfocus(c);
+        if (c->occluded) /* on top now, send what its layout chose */
+            geomdirty = 1;
     } else {
         XSetInputFocus(dpy, root, RevertToPointerRoot, CurrentTime);
         XDeleteProperty(dpy, root, netatom[NetActiveWindow]);
     }
     selmon->sel = c;
-    drawbars();
+    if (selmon->pertag->layout[selmon->pertag->curtag]->arrange == scroll)
+        markdirty(selmon, DirtyScroll); /* bring it into view */
+    markdirty(NULL, DirtyBar);
 }
 
 /* there are some broken focus acquiring clients needing extra handling */
@@ -594,7 +935,7 @@ void focusstack(const Arg* arg) {
         focus(c);
         restack(selmon);
         if (c->isfloating || selmon->pertag->layout[selmon->pertag->curtag]->arrange == &layout_float)
-            XRaiseWindow(dpy, c->win);
+            raiseclient(c);
     }
 }
 
@@ -622,26 +963,7 @@ int getrootptr(int* x, int* y) {
     return XQueryPointer(dpy, root, &dummy, &dummy, x, y, &di, &di, &dui);
 }
 
-long getstate(Window w) {
-    int format;
-    long result      = -1;
-    unsigned char* p = NULL;
-    unsigned long n, extra;
-    Atom real;
-
-    if (XGetWindowProperty(dpy, w, wmatom[WMState], 0L, 2L, False, wmatom[WMState],
-            &real, &format, &n, &extra, (unsigned char**)&p)
-        != Success)
-        return -1;
-    if (n != 0)
-        result = *p;
-    XFree(p);
-    return result;
-}
-
 int gettextprop(Window w, Atom atom, char* text, unsigned int size) {
-    char** list = NULL;
-    int n;
     XTextProperty name;
 
     if (!text || size == 0)
@@ -649,54 +971,79 @@ int gettextprop(Window w, Atom atom, char* text, unsigned int size) {
     text[0] = '\0';
     if (!XGetTextProperty(dpy, w, &name, atom) || !name.nitems)
         return 0;
-    if (name.encoding == XA_STRING)
-        strncpy(text, (char*)name.value, size - 1);
-    else {
-        if (XmbTextPropertyToTextList(dpy, &name, &list, &n) >= Success && n > 0 && *list) {
-            strncpy(text, *list, size - 1);
-            XFreeStringList(list);
-        }
-    }
-    text[size - 1] = '\0';
+    decodetextprop(&name, text, size);
     XFree(name.value);
     return 1;
 }
 
 void grabbuttons(Client* c, int focused) {
-    updatenumlockmask();
-    {
-        unsigned int i, j;
-        unsigned int modifiers[] = { 0, LockMask, numlockmask, numlockmask | LockMask };
+    unsigned int i, j;
+    unsigned int modifiers[] = { 0, LockMask, numlockmask, numlockmask | LockMask };
+    int state = focused ? GrabFocused : GrabUnfocused;
+
+    /* the grabs only depend on the focus and numlockmask */
+    if (c->grabbed == state)
+        return;
+    c->grabbed = state;
+    if (focused)
         XUngrabButton(dpy, AnyButton, AnyModifier, c->win);
-        if (!focused)
-            XGrabButton(dpy, AnyButton, AnyModifier, c->win, False,
-                BUTTONMASK, GrabModeSync, GrabModeSync, None, None);
-        for (i = 0; i < nbuttons; i++)
-            if (buttons[i].click == ClkClientWin)
-                for (j = 0; j < LENGTH(modifiers); j++)
-                    XGrabButton(dpy, buttons[i].button,
-                        buttons[i].mask | modifiers[j],
-                        c->win, False, BUTTONMASK,
-                        GrabModeAsync, GrabModeSync, None, None);
-    }
+    else /* replaces all other grabs on the window */
+        XGrabButton(dpy, AnyButton, AnyModifier, c->win, False,
+            BUTTONMASK, GrabModeSync, GrabModeSync, None, None);
+    for (i = 0; i < nbuttons; i++)
+        if (buttons[i].click == ClkClientWin)
+            for (j = 0; j < LENGTH(modifiers); j++)
+                XGrabButton(dpy, buttons[i].button,
+                    buttons[i].mask | modifiers[j],
+                    c->win, False, BUTTONMASK,
+                    GrabModeAsync, GrabModeSync, None, None);
 }
 
 void grabkeys(void) {
-    updatenumlockmask();
-    {
-        unsigned int i, j;
-        unsigned int modifiers[] = { 0, LockMask, numlockmask, numlockmask | LockMask };
-        KeyCode code;
-
-        XUngrabKey(dpy, AnyKey, AnyModifier, root);
-        for (i = 0; i < nkeys; i++)
-            if ((code = XKeysymToKeycode(dpy, keys[i].keysym)))
-                for (j = 0; j < LENGTH(modifiers); j++)
-                    XGrabKey(dpy, code, keys[i].mod | modifiers[j], root,
-                        True, GrabModeAsync, GrabModeAsync);
+    unsigned int i, j, n = 0;
+    unsigned int modifiers[] = { 0, LockMask, numlockmask, numlockmask | LockMask };
+    int code, mincode, maxcode;
+    KeySym syms[256];
+
+    /* bindings match the unshifted keysym of the first group, like
+     * XKeycodeToKeysym(dpy, code, 0) did */
+    XDisplayKeycodes(dpy, &mincode, &maxcode);
+    for (code = 0; code < 256; code++) {
+        syms[code] = code >= mincode && code <= maxcode ? XkbKeycodeToKeysym(dpy, code, 0, 0) : NoSymbol;
+        keystart[code] = n;
+        if (syms[code] != NoSymbol)
+            for (i = 0; i < nkeys; i++)
+                n += keys[i].keysym == syms[code];
+    }
+    keystart[256] = n;
+    free(keybinds);
+    keybinds = ecalloc(n ? n : 1, sizeof(Key*));
+    XUngrabKey(dpy, AnyKey, AnyModifier, root);
+    for (code = 0, n = 0; code < 256; code++) {
+        if (syms[code] == NoSymbol)
+            continue;
+        for (i = 0; i < nkeys; i++) {
+            if (keys[i].keysym != syms[code])
+                continue;
+            keybinds[n++] = &keys[i];
+            for (j = 0; j < LENGTH(modifiers); j++)
+                XGrabKey(dpy, code, keys[i].mod | modifiers[j], root,
+                    True, GrabModeAsync, GrabModeAsync);
+        }
     }
 }
 
+void hideclient(Client* c) {
+    /* the root window still reports the unmap, unmapnotify() skips that one */
+    XSelectInput(dpy, c->win, CLIENTMASK & ~StructureNotifyMask);
+    XUnmapWindow(dpy, c->win);
+    XSelectInput(dpy, c->win, CLIENTMASK);
+    c->ignoreunmap++;
+    c->iconic = 1;
+    setclientstate(c, IconicState);
+    updatewmstate(c);
+}
+
 void incnmaster(const Arg* arg) {
     selmon->nmaster = selmon->pertag->nmasters[selmon->pertag->curtag] = MAX(selmon->nmaster + arg->i, 0);
     arrange(selmon);
@@ -712,17 +1059,16 @@ isuniquegeom(XineramaScreenInfo* unique, size_t n, XineramaScreenInfo* info) {
 }
 
 void keypress(XEvent* e) {
-    unsigned int i;
-    KeySym keysym;
-    XKeyEvent* ev;
-
-    ev     = &e->xkey;
-    keysym = XKeycodeToKeysym(dpy, (KeyCode)ev->keycode, 0);
-    for (i = 0; i < nkeys; i++)
-        if (keysym == keys[i].keysym
-            && CLEANMASK(keys[i].mod) == CLEANMASK(ev->state)
-            && keys[i].func)
-            keys[i].func(&(keys[i].arg));
+    unsigned int i, mod;
+    const Key* k;
+    XKeyEvent* ev = &e->xkey;
+
+    mod = CLEANMASK(ev->state);
+    for (i = keystart[ev->keycode & 0xff]; i < keystart[(ev->keycode & 0xff) + 1]; i++) {
+        k = keybinds[i];
+        if (CLEANMASK(k->mod) == mod && k->func)
+            k->func(&k->arg);
+    }
 }
 
 void killclient(Client* c) {
@@ -731,7 +1077,7 @@ void killclient(Client* c) {
         XSetErrorHandler(xerrordummy);
         XSetCloseDownMode(dpy, DestroyAll);
         XKillClient(dpy, c->win);
-        XSync(dpy, False);
+        xsync();
         XSetErrorHandler(xerror);
         XUngrabServer(dpy);
     }
@@ -748,7 +1094,7 @@ void closewindow(const Arg* arg) {
         return;
     unsigned int newtags = selmon->sel->tags ^ selmon->tagset[selmon->seltags];
     if (newtags != 0) {
-        selmon->sel->tags = newtags;
+        settags(selmon->sel, newtags);
         focus(NULL);
         arrange(selmon);
     } else {
@@ -756,23 +1102,53 @@ void closewindow(const Arg* arg) {
     }
 }
 
-void manage(Window w, XWindowAttributes* wa) {
+/* Puts the clients of m->tiled where lc says if it was filled for the same
+ * layout inputs, returns 0 if it was not. */
+int loadlayout(Monitor* m, LayoutCache* lc) {
+    LayoutSlot* s;
+    Client* c;
+    unsigned int i;
+
+    if (lc->arrange != m->pertag->layout[m->pertag->curtag]->arrange
+        || lc->mfact != m->mfact || lc->nmaster != m->nmaster
+        || lc->wx != m->wx || lc->wy != m->wy || lc->ww != m->ww || lc->wh != m->wh
+        || lc->nslots != m->ntiled)
+        return 0;
+    for (i = 0; i < m->ntiled; i++) {
+        c = m->tiled[i];
+        s = &lc->slots[i];
+        if (s->id != c->id || s->cfact != c->cfact || s->hintsgen != c->hintsgen || s->bw != c->bw)
+            return 0;
+    }
+    for (i = 0; i < m->ntiled; i++) {
+        s = &lc->slots[i];
+        placeclient(m->tiled[i], s->x, s->y, s->w, s->h, s->pbw);
+    }
+    memcpy(m->ltsymbol, lc->ltsymbol, sizeof m->ltsymbol);
+    return 1;
+}
+
+void manage(Window w, WinProps* p) {
     Client *c, *t = NULL;
-    Window trans = None;
     XWindowChanges wc;
 
-    c      = ecalloc(1, sizeof(Client));
-    c->win = w;
+    c       = pool_alloc(&clientpool);
+    c->cold = pool_alloc(&coldpool);
+    c->win  = w;
+    c->id   = ++clientids;
     /* geometry */
-    c->x = c->oldx = wa->x;
-    c->y = c->oldy = wa->y;
-    c->w = c->oldw = wa->width;
-    c->h = c->oldh = wa->height;
-    c->oldbw       = wa->border_width;
+    c->x = c->oldx = p->wa.x;
+    c->y = c->oldy = p->wa.y;
+    c->w = c->oldw = p->wa.width;
+    c->h = c->oldh = p->wa.height;
+    c->oldbw       = p->wa.border_width;
     c->cfact       = 1.0;
 
-    updatetitle(c);
-    if (XGetTransientForHint(dpy, w, &trans) && (t = wintoclient(trans))) {
+    strcpy(c->cold->name, p->name);
+    strcpy(c->cold->class, p->class);
+    strcpy(c->cold->instance, p->instance);
+    c->protocols = p->protocols;
+    if (p->trans != None && (t = wintoclient(p->trans))) {
         c->mon  = t->mon;
         c->tags = t->tags;
     } else {
@@ -787,60 +1163,207 @@ void manage(Window w, XWindowAttributes* wa) {
     c->x = MAX(c->x, c->mon->mx);
     /* only fix client y-offset, if the client center might cover the bar */
     c->y  = MAX(c->y, ((c->mon->by == c->mon->my) && (c->x + (c->w / 2) >= c->mon->wx) && (c->x + (c->w / 2) < c->mon->wx + c->mon->ww)) ? bh : c->mon->my);
-    c->bw = borderpx;
+    c->bw = c->pbw = borderpx;
 
     for (unsigned int i = 0; i < 10; i++) {
-        c->fx[i] = c->x;
-        c->fy[i] = c->y;
-        c->fw[i] = c->w;
-        c->fh[i] = c->h;
+        c->cold->fx[i] = c->x;
+        c->cold->fy[i] = c->y;
+        c->cold->fw[i] = c->w;
+        c->cold->fh[i] = c->h;
     }
 
     wc.border_width = c->bw;
     XConfigureWindow(dpy, w, CWBorderWidth, &wc);
     XSetWindowBorder(dpy, w, scheme[SchemeNorm][ColBorder].pixel);
     configure(c); /* propagates border_width, if size doesn't change */
-    updatewindowtype(c);
-    updatesizehints(c);
-    updatewmhints(c);
-    XSelectInput(dpy, w, EnterWindowMask | FocusChangeMask | PropertyChangeMask | StructureNotifyMask);
+    setwindowtype(c, p->state, p->wtype);
+    setsizehints(c, &p->size);
+    if (tagframes) {
+        /* before selecting StructureNotify, so only the root window reports
+         * the unmap of a window scan() adopted mapped */
+        c->frame       = TAGFRAME(c->mon, c->tags);
+        c->ignoreunmap = p->wa.map_state != IsUnmapped;
+        XAddToSaveSet(dpy, w);
+        XReparentWindow(dpy, w, c->frame, c->x - c->mon->mx, c->y - c->mon->my);
+    }
+    XSelectInput(dpy, w, CLIENTMASK);
     grabbuttons(c, 0);
     if (!c->isfloating)
-        c->isfloating = c->oldstate = trans != None || c->isfixed;
+        c->isfloating = c->oldstate = p->trans != None || c->isfixed;
     if (c->isfloating)
-        XRaiseWindow(dpy, c->win);
+        raiseclient(c);
     attach(c);
     attachstack(c);
-    XChangeProperty(dpy, root, netatom[NetClientList], XA_WINDOW, 32, PropModeAppend,
-        (unsigned char*)&(c->win), 1);
-    XMoveResizeWindow(dpy, c->win, c->x + 2 * sw, c->y, c->w, c->h); /* some windows require this */
+    if (p->haswmh) /* may change the urgency counted by attach() */
+        setwmhints(c, &p->wmh);
+    winmap_add(c->win, c, NULL);
+    if (nclientwins == clientwinssize) {
+        clientwinssize = clientwinssize ? 2 * clientwinssize : 64;
+        clientwins     = erealloc(clientwins, clientwinssize * sizeof(Window));
+        stackingwins   = erealloc(stackingwins, clientwinssize * sizeof(Window));
+        raisedclients  = erealloc(raisedclients, clientwinssize * sizeof(Client*));
+    }
+    c->raised                 = ++raises; /* mapped on top */
+    c->listpos                = nclientwins;
+    clientwins[nclientwins++] = c->win;
+    listsdirty |= ListClients;
+    c->sent.x            = c->x + 2 * sw - FRAMEX(c);
+    c->sent.y            = c->y - FRAMEY(c);
+    XMoveResizeWindow(dpy, c->win, c->sent.x, c->sent.y, c->w, c->h); /* some windows require this */
+    c->sent.width        = c->w;
+    c->sent.height       = c->h;
+    c->sent.border_width = c->bw;
     setclientstate(c, NormalState);
-    if (c->mon == selmon)
+    /* while scanning nothing is focused yet, scan() focuses once after
+     * every window has been adopted */
+    if (c->mon == selmon && !scanner)
         unfocus(selmon->sel, 0);
     c->mon->sel = c;
     arrange(c->mon);
     XMapWindow(dpy, c->win);
-    focus(NULL);
+    if (!scanner)
+        focus(NULL);
 }
 
 void mappingnotify(XEvent* e) {
     XMappingEvent* ev = &e->xmapping;
+    unsigned int oldmask = numlockmask;
+    Client* c;
+    Monitor* m;
+    int focused;
 
     XRefreshKeyboardMapping(ev);
-    if (ev->request == MappingKeyboard)
+    if (ev->request == MappingPointer)
+        return;
+    updatenumlockmask();
+    if (ev->request == MappingKeyboard || numlockmask != oldmask)
         grabkeys();
+    if (numlockmask == oldmask)
+        return;
+    for (m = mons; m; m = m->next)
+        for (c = m->clients; c; c = c->next) {
+            focused    = c->grabbed == GrabFocused;
+            c->grabbed = GrabNone;
+            grabbuttons(c, focused);
+        }
 }
 
 void maprequest(XEvent* e) {
-    static XWindowAttributes wa;
+    static WinProps p;
+    PropRequest r;
+    struct timespec start, end;
+    unsigned long ns;
     XMapRequestEvent* ev = &e->xmaprequest;
 
-    if (!XGetWindowAttributes(dpy, ev->window, &wa))
+    if (wintoclient(ev->window))
         return;
-    if (wa.override_redirect)
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    requestprops(ev->window, &r);
+    if (!readprops(&r, &p) || p.wa.override_redirect)
+        return;
+    manage(ev->window, &p);
+    /* latency from the request to the XMapWindow() in manage() */
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ns = (end.tv_sec - start.tv_sec) * 1000000000UL + end.tv_nsec - start.tv_nsec;
+    stats.maps++;
+    stats.mapns += ns;
+    stats.maxmapns = MAX(stats.maxmapns, ns);
+}
+
+void markdirty(Monitor* m, unsigned int flags) {
+    if (m)
+        m->dirty |= flags;
+    else
+        for (m = mons; m; m = m->next)
+            m->dirty |= flags;
+}
+
+/* Sets occluded on the tiled clients monocle and deck put under the one on
+ * top, which is the first of them in the focus stack. A client is only
+ * occluded while the window as the server has it lies within the top one,
+ * so nothing it still shows elsewhere goes stale. */
+void markoccluded(Monitor* m) {
+    void (*arrange)(Monitor*) = m->pertag->layout[m->pertag->curtag]->arrange;
+    Client *c, *top;
+    int i, x, y, first = arrange == deck ? m->nmaster : 0;
+
+    for (c = m->clients; c; c = c->next)
+        c->occluded = 0;
+    if (arrange != monocle && arrange != deck)
+        return;
+    for (i = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), i++)
+        c->occluded = i >= first;
+    for (top = m->stack; top && !top->occluded; top = top->snext)
+        ;
+    if (!top)
         return;
-    if (!wintoclient(ev->window))
-        manage(ev->window, &wa);
+    top->occluded = 0;
+    x             = top->x - FRAMEX(top);
+    y             = top->y - FRAMEY(top);
+    for (c = m->clients; c; c = c->next)
+        if (c->occluded
+            && (c->sent.x < x || c->sent.y < y
+                || c->sent.x + c->sent.width + 2 * c->sent.border_width > x + top->w + 2 * top->pbw
+                || c->sent.y + c->sent.height + 2 * c->sent.border_width > y + top->h + 2 * top->pbw))
+            c->occluded = 0;
+}
+
+/* After the view of m was arranged: the tags its tiled clients are on no
+ * longer have their own arrangement, except a tag viewed alone, which was
+ * just arranged. Has prearrange() run if it can redo a stale tag. */
+void markstale(Monitor* m) {
+    unsigned int i, tags = 0, view = m->tagset[m->seltags];
+
+    for (i = 0; i < m->ntiled; i++)
+        tags |= m->tiled[i]->tags;
+    if (view & (view - 1))
+        tags |= view;
+    else {
+        tags &= ~view;
+        m->staletags &= ~view;
+    }
+    m->staletags = (m->staletags | tags) & m->occ; /* empty tags have nothing to redo */
+    if (m->staletags & ~tags & ~view)
+        settimeout(prearrange, PREARRANGEDELAY);
+}
+
+/* fold prev into the later event next of the same type and window, returns
+ * whether prev can be dropped */
+int mergeevent(XEvent* next, XEvent* prev) {
+    XConfigureRequestEvent *nc, *pc;
+    unsigned long mask;
+
+    if (next->type != prev->type)
+        return 0;
+    switch (next->type) {
+    case PropertyNotify:
+        return next->xproperty.atom == prev->xproperty.atom;
+    case ConfigureRequest:
+        nc = &next->xconfigurerequest;
+        pc = &prev->xconfigurerequest;
+        /* configurerequest() ignores the geometry of border width changes */
+        if ((nc->value_mask ^ pc->value_mask) & CWBorderWidth)
+            return 0;
+        mask = pc->value_mask & ~nc->value_mask;
+        if (mask & CWX)
+            nc->x = pc->x;
+        if (mask & CWY)
+            nc->y = pc->y;
+        if (mask & CWWidth)
+            nc->width = pc->width;
+        if (mask & CWHeight)
+            nc->height = pc->height;
+        if (mask & CWSibling)
+            nc->above = pc->above;
+        if (mask & CWStackMode)
+            nc->detail = pc->detail;
+        nc->value_mask |= mask;
+        return 1;
+    case Expose:
+    case MotionNotify:
+        return 1;
+    }
+    return 0;
 }
 
 void motionnotify(XEvent* e) {
@@ -870,7 +1393,8 @@ void movemouse(const Arg* arg) {
     if (c->isfullscreen) /* no support moving fullscreen windows by mouse */
         return;
     restack(selmon);
-    XRaiseWindow(dpy, c->win);
+    flushpending();
+    raiseclient(c);
     ocx = c->x;
     ocy = c->y;
     if (XGrabPointer(dpy, root, False, MOUSEMASK, GrabModeAsync, GrabModeAsync,
@@ -909,6 +1433,7 @@ void movemouse(const Arg* arg) {
                 resize(c, nx, ny, c->w, c->h, 1);
             break;
         }
+        flushpending();
     } while (ev.type != ButtonRelease);
     XUngrabPointer(dpy, CurrentTime);
     if ((m = recttomon(c->x, c->y, c->w, c->h)) != selmon) {
@@ -922,6 +1447,21 @@ void movemouse(const Arg* arg) {
     }
 }
 
+/* Read the queued events up to and including the next key or button press.
+ * Their bindings may run their own event loop (movemouse) which has to find
+ * the events that follow still queued. */
+int nextbatch(XEvent* evs, int max) {
+    int n = 0, type;
+
+    while (n < max && XPending(dpy)) {
+        XNextEvent(dpy, &evs[n]);
+        type = evs[n++].type;
+        if (type == KeyPress || type == ButtonPress)
+            break;
+    }
+    return n;
+}
+
 Client*
 nexttiled(Client* c) {
     for (; c && (c->isfloating || !ISVISIBLE(c) || ISHIDDEN(c)); c = c->next)
@@ -929,6 +1469,74 @@ nexttiled(Client* c) {
     return c;
 }
 
+/* Arranges hidden tags once layouts stopped changing, so their clients
+ * already have the right size when the tag is viewed and only need to be
+ * moved. The previous tag goes first, being the likeliest next view. Tags
+ * sharing a client with the view would resize it and are skipped. */
+void prearrange(void) {
+    Monitor* m;
+    Client* c;
+    unsigned int i, n, t, shared;
+
+    for (m = mons; m; m = m->next) {
+        shared = m->tagset[m->seltags];
+        for (c = m->clients; c; c = c->next)
+            if (ISVISIBLE(c))
+                shared |= c->tags;
+        for (i = n = 0; i <= (unsigned int)ntags && n < (unsigned int)prearrangetags; i++) {
+            t = i ? i : m->pertag->prevtag; /* pertag index, 0 is every tag */
+            if (!t || !(m->staletags & ~shared & 1 << (t - 1)))
+                continue; /* shared ones stay stale until the view changes */
+            m->staletags &= ~(1 << (t - 1));
+            if (m->pertag->layout[t]->arrange == layout_float)
+                continue; /* it only restores geometry, saved per selmon tag */
+            arrangetag(m, t);
+            stats.prearranges++;
+            n++;
+        }
+    }
+}
+
+void printstats(void) {
+    fprintf(stderr, "dwm: %lu arranges, %lu XSync calls (%.2f per arrange)\n",
+        stats.arranges, stats.syncs,
+        stats.arranges ? (double)stats.syncs / stats.arranges : 0.0);
+    fprintf(stderr, "dwm: %lu arranges reused a cached layout\n", stats.cachedlayouts);
+    fprintf(stderr, "dwm: %lu wakeups, %lu events (%.2f per wakeup, at most %lu)\n",
+        stats.wakeups, stats.events,
+        stats.wakeups ? (double)stats.events / stats.wakeups : 0.0, stats.maxbatch);
+    fprintf(stderr, "dwm: %lu events dispatched, %lu coalesced\n",
+        stats.dispatched, stats.events - stats.dispatched);
+    fprintf(stderr, "dwm: %lu windows restacked\n", stats.restacks);
+    fprintf(stderr, "dwm: %lu client configures, %lu synthetic ConfigureNotify\n",
+        stats.configures, stats.notifies);
+    fprintf(stderr, "dwm: %lu configures of occluded clients deferred\n", stats.deferred);
+    fprintf(stderr, "dwm: %lu windows adopted at startup in %.3f ms\n",
+        stats.scanned, stats.scanns / 1e6);
+    fprintf(stderr, "dwm: %lu windows mapped, %.3f ms average, %.3f ms max\n",
+        stats.maps, stats.maps ? stats.mapns / 1e6 / stats.maps : 0.0, stats.maxmapns / 1e6);
+    fprintf(stderr, "dwm: %lu views, %.3f ms average, %.3f ms max, %.1f requests each\n",
+        stats.views, stats.views ? stats.viewns / 1e6 / stats.views : 0.0, stats.maxviewns / 1e6,
+        stats.views ? (double)stats.viewreqs / stats.views : 0.0);
+    fprintf(stderr, "dwm: %lu hidden tags arranged in the background\n", stats.prearranges);
+}
+
+/* Gives c the geometry a layout chose, commitgeometry() sends it. */
+void placeclient(Client* c, int x, int y, int w, int h, int pbw) {
+    c->pbw = pbw;
+    if (c->x == x && c->y == y && c->w == w && c->h == h)
+        return;
+    c->oldx   = c->x;
+    c->oldy   = c->y;
+    c->oldw   = c->w;
+    c->oldh   = c->h;
+    c->x      = x;
+    c->y      = y;
+    c->w      = w;
+    c->h      = h;
+    geomdirty = 1;
+}
+
 void propertynotify(XEvent* e) {
     Client* c;
     Window trans;
@@ -936,40 +1544,98 @@ void propertynotify(XEvent* e) {
 
     if ((ev->window == root) && (ev->atom == XA_WM_NAME))
         updatestatus();
-    else if (ev->state == PropertyDelete)
-        return; /* ignore */
-    else if ((c = wintoclient(ev->window))) {
+    else if (!(c = wintoclient(ev->window)))
+        return;
+    else if (ev->state == PropertyDelete) {
+        /* forget cached properties, everything else is ignored */
+        if (ev->atom == wmatom[WMProtocols])
+            c->protocols = 0;
+        else if (ev->atom == XA_WM_HINTS)
+            c->cold->haswmh = c->cold->wmh.flags = 0;
+        else if (ev->atom == XA_WM_CLASS)
+            c->cold->class[0] = c->cold->instance[0] = '\0';
+    } else {
         switch (ev->atom) {
         default:
             break;
+        case XA_WM_CLASS:
+            updateclass(c);
+            break;
         case XA_WM_TRANSIENT_FOR:
             if (!c->isfloating && (XGetTransientForHint(dpy, c->win, &trans)) && (c->isfloating = (wintoclient(trans)) != NULL))
                 arrange(c->mon);
             if (c->isfloating && c == selmon->sel)
-                XRaiseWindow(dpy, c->win);
+                raiseclient(c);
             break;
         case XA_WM_NORMAL_HINTS:
             updatesizehints(c);
             break;
         case XA_WM_HINTS:
             updatewmhints(c);
-            drawbars();
+            markdirty(NULL, DirtyBar);
             break;
         }
         if (ev->atom == XA_WM_NAME || ev->atom == netatom[NetWMName]) {
             updatetitle(c);
             if (c == c->mon->sel)
-                drawbar(c->mon);
+                markdirty(c->mon, DirtyBar);
         }
         if (ev->atom == netatom[NetWMWindowType])
             updatewindowtype(c);
+        if (ev->atom == wmatom[WMProtocols])
+            updateprotocols(c);
     }
 }
 
+unsigned int protocolbit(Atom proto) {
+    unsigned int i;
+
+    for (i = 0; i < WMLast; i++)
+        if (wmatom[i] == proto)
+            return 1 << i;
+    return 0;
+}
+
 void quit(const Arg* arg) {
     running = 0;
 }
 
+/* raises c above everything, its place in the stacking order of the last
+ * restackmon() is lost */
+void raiseclient(Client* c) {
+    XRaiseWindow(dpy, c->win);
+    c->stackpos = 0;
+    c->raised   = ++raises;
+    listsdirty |= ListStacking;
+}
+
+int raisedcmp(const void* a, const void* b) {
+    const Client *ca = *(Client* const*)a, *cb = *(Client* const*)b;
+
+    return (ca->raised > cb->raised) - (ca->raised < cb->raised);
+}
+
+void readsignals(void) {
+    struct signalfd_siginfo si;
+
+    while (read(sigfd, &si, sizeof si) == sizeof si) {
+        switch (si.ssi_signo) {
+        case SIGCHLD:
+            /* one SIGCHLD may stand for several exited children */
+            while (0 < waitpid(-1, NULL, WNOHANG))
+                ;
+            break;
+        case SIGHUP:
+        case SIGTERM:
+            running = 0;
+            break;
+        case SIGUSR1:
+            printstats();
+            break;
+        }
+    }
+}
+
 Monitor*
 recttomon(int x, int y, int w, int h) {
     Monitor *m, *r = selmon;
@@ -989,27 +1655,27 @@ void resize(Client* c, int x, int y, int w, int h, int interact) {
 }
 
 void resizeclient(Client* c, int x, int y, int w, int h) {
-    XWindowChanges wc;
     unsigned int n;
     unsigned int gapoffset;
     unsigned int gapincr;
-    Client* nbc;
+    Client* t;
 
-    wc.border_width = c->bw;
-
-    /* Get number of clients for the selected monitor */
-    for (n = 0, nbc = nexttiled(c->mon->clients); nbc; nbc = nexttiled(nbc->next), n++)
-        ;
+    c->pbw = c->bw;
 
     /* Do nothing if layout is floating */
     if (c->isfloating || c->mon->pertag->layout[c->mon->pertag->curtag]->arrange == layout_float) {
         gapincr = gapoffset = 0;
     } else {
+        /* the fullscreen and mouse paths come here with a layout pending, so
+         * m->tiled may be out of date (see updatetiled()); count them up to
+         * the two that matter here */
+        for (n = 0, t = nexttiled(c->mon->clients); t && n < 2; t = nexttiled(t->next), n++)
+            ;
         /* Remove border and gap if layout is monocle or only one client */
         if (c->mon->pertag->layout[c->mon->pertag->curtag]->arrange == monocle || n <= 1) {
-            gapoffset       = 0;
-            gapincr         = -2 * borderpx;
-            wc.border_width = 0;
+            gapoffset = 0;
+            gapincr   = -2 * borderpx;
+            c->pbw    = 0;
         } else {
             gapoffset = gappx;
             gapincr   = 2 * gappx;
@@ -1017,24 +1683,23 @@ void resizeclient(Client* c, int x, int y, int w, int h) {
     }
 
     c->oldx = c->x;
-    c->x = wc.x = x + gapoffset;
-    c->oldy     = c->y;
-    c->y = wc.y = y + gapoffset;
-    c->oldw     = c->w;
-    c->w = wc.width = w - gapincr;
-    c->oldh         = c->h;
-    c->h = wc.height = h - gapincr;
+    c->x    = x + gapoffset;
+    c->oldy = c->y;
+    c->y    = y + gapoffset;
+    c->oldw = c->w;
+    c->w    = w - gapincr;
+    c->oldh = c->h;
+    c->h    = h - gapincr;
 
     if (selmon->pertag->layout[selmon->pertag->curtag]->arrange == layout_float) {
-        c->fx[selmon->pertag->curtag] = c->x;
-        c->fy[selmon->pertag->curtag] = c->y;
-        c->fw[selmon->pertag->curtag] = c->w;
-        c->fh[selmon->pertag->curtag] = c->h;
+        c->cold->fx[selmon->pertag->curtag] = c->x;
+        c->cold->fy[selmon->pertag->curtag] = c->y;
+        c->cold->fw[selmon->pertag->curtag] = c->w;
+        c->cold->fh[selmon->pertag->curtag] = c->h;
     }
 
-    XConfigureWindow(dpy, c->win, CWX | CWY | CWWidth | CWHeight | CWBorderWidth, &wc);
-    configure(c);
-    XSync(dpy, False);
+    /* sent by commitgeometry(), together with the rest of the layout */
+    geomdirty = 1;
 }
 
 void resizemouse(const Arg* arg) {
@@ -1054,7 +1719,8 @@ void resizemouse(const Arg* arg) {
     if (c->isfullscreen) /* no support resizing fullscreen windows by mouse */
         return;
     restack(selmon);
-    XRaiseWindow(dpy, c->win);
+    flushpending();
+    raiseclient(c);
     ocx  = c->x;
     ocy  = c->y;
     ocx2 = c->x + c->w;
@@ -1110,6 +1776,7 @@ void resizemouse(const Arg* arg) {
                 resize(c, nx, ny, nw, nh, 1);
             break;
         }
+        flushpending();
     } while (ev.type != ButtonRelease);
     XWarpPointer(dpy, None, c->win, 0, 0, 0, 0,
         horizcorner ? (-c->bw) : (c->w + c->bw - 1),
@@ -1125,73 +1792,232 @@ void resizemouse(const Arg* arg) {
 }
 
 void restack(Monitor* m) {
-    Client* c;
-    XEvent ev;
+    markdirty(m, DirtyStack | DirtyBar);
+}
+
+/* Stacks the tiled clients below the bar in focus order. Clients which kept
+ * their place since the last call and form the longest run already in the
+ * right relative order stay, only the others are restacked. */
+void restackmon(Monitor* m) {
+    Client *c, **order;
     XWindowChanges wc;
+    unsigned int i, j, n = 0, len = 0, lo, hi;
+    unsigned int *tail, *prev;
+    char* keep;
+    unsigned int* gen = tagframes && m->curframe >= 0 ? &m->framegens[m->curframe] : &m->stackgen;
 
-    drawbar(m);
     if (!m->sel)
         return;
-    if (m->pertag->layout[m->pertag->curtag]->arrange != &layout_float) {
-        wc.stack_mode = Below;
-        wc.sibling    = m->barwin;
-        for (c = m->stack; c; c = c->snext)
-            if (!c->isfloating && ISVISIBLE(c) && !ISHIDDEN(c)) {
-                XConfigureWindow(dpy, c->win, CWSibling | CWStackMode, &wc);
-                wc.sibling = c->win;
-            }
+    if (m->pertag->layout[m->pertag->curtag]->arrange == &layout_float) {
+        (*gen)++; /* clients are raised at will, forget the order */
+        return;
     }
-    XSync(dpy, False);
-    while (XCheckMaskEvent(dpy, EnterWindowMask, &ev))
-        ;
+    for (c = m->stack; c; c = c->snext)
+        n += !c->isfloating && ISVISIBLE(c) && !ISHIDDEN(c);
+    order = ecalloc(n + 1, sizeof(Client*));
+    tail  = ecalloc(n + 1, sizeof(unsigned int));
+    prev  = ecalloc(n + 1, sizeof(unsigned int));
+    keep  = ecalloc(n + 1, 1);
+    for (n = 0, c = m->stack; c; c = c->snext)
+        if (!c->isfloating && ISVISIBLE(c) && !ISHIDDEN(c))
+            order[n++] = c;
+    /* longest increasing subsequence of the previous positions, tail[k] is
+     * the end of the best run of length k + 1 found so far */
+    for (i = 0; i < n; i++) {
+        if (order[i]->stackgen != *gen || !order[i]->stackpos)
+            continue;
+        for (lo = 0, hi = len; lo < hi;) {
+            j = (lo + hi) / 2;
+            if (order[tail[j]]->stackpos < order[i]->stackpos)
+                lo = j + 1;
+            else
+                hi = j;
+        }
+        prev[i] = lo ? tail[lo - 1] : n;
+        tail[lo] = i;
+        len += lo == len;
+    }
+    for (i = len ? tail[len - 1] : n; i != n; i = prev[i])
+        keep[i] = 1;
+    (*gen)++;
+    wc.stack_mode = Below;
+    for (i = 0; i < n; i++) {
+        if (!keep[i]) {
+            if (i)
+                wc.sibling = order[i - 1]->win;
+            else
+                wc.sibling = tagframes && m->curframe >= 0 ? m->framemarks[m->curframe] : m->barwin;
+            XConfigureWindow(dpy, order[i]->win, CWSibling | CWStackMode, &wc);
+            stats.restacks++;
+            listsdirty |= ListStacking;
+        }
+        order[i]->stackpos = i + 1;
+        order[i]->stackgen = *gen;
+    }
+    free(order);
+    free(tail);
+    free(prev);
+    free(keep);
 }
 
 void run(void) {
-    XEvent ev;
+    XEvent evs[EVBATCH];
+    struct epoll_event events[3];
+    unsigned long batch;
+    int i, n;
+
     /* main event loop */
-    XSync(dpy, False);
-    while (running && !XNextEvent(dpy, &ev))
-        if (handler[ev.type])
-            handler[ev.type](&ev); /* call handler */
+    xsync();
+    while (running) {
+        /* handle everything the server has sent so far as one batch */
+        for (batch = 0; running && (n = nextbatch(evs, LENGTH(evs))); batch += n) {
+            coalesce(evs, n);
+            for (i = 0; i < n && running; i++)
+                if (evs[i].type && handler[evs[i].type]) {
+                    stats.dispatched++;
+                    handler[evs[i].type](&evs[i]); /* call handler */
+                }
+        }
+        stats.events += batch;
+        stats.maxbatch = MAX(stats.maxbatch, batch);
+        flushpending();
+        /* nothing else sends what flushpending() and the timers queued before
+         * the next wakeup, which might never come */
+        XFlush(dpy);
+        /* flushpending() may have read more events while waiting for a reply */
+        if (!running || XEventsQueued(dpy, QueuedAlready))
+            continue;
+        if ((n = epoll_wait(epollfd, events, LENGTH(events), -1)) == -1) {
+            if (errno == EINTR)
+                continue;
+            die("epoll_wait:");
+        }
+        stats.wakeups++;
+        for (i = 0; i < n; i++)
+            if (events[i].data.fd == sigfd)
+                readsignals();
+            else if (events[i].data.fd == timerfd)
+                runtimers();
+        /* the X connection is read by XPending() above */
+    }
+}
+
+void runtimers(void) {
+    struct timespec now;
+    uint64_t expirations;
+    void (*func)(void);
+    int i;
+
+    if (read(timerfd, &expirations, sizeof expirations) == -1 && errno != EAGAIN)
+        die("read timerfd:");
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    for (i = 0; i < MAXTIMERS; i++) {
+        if (!timers[i].func || timers[i].due.tv_sec > now.tv_sec
+            || (timers[i].due.tv_sec == now.tv_sec && timers[i].due.tv_nsec > now.tv_nsec))
+            continue;
+        func           = timers[i].func;
+        timers[i].func = NULL;
+        func();
+    }
+    armtimers();
+}
+
+/* Remembers the arrangement the layout just made of m->tiled. */
+void savelayout(Monitor* m, LayoutCache* lc) {
+    LayoutSlot* s;
+    Client* c;
+    unsigned int i;
+
+    if (m->ntiled > lc->size) {
+        lc->size  = m->ntiled;
+        lc->slots = erealloc(lc->slots, lc->size * sizeof(LayoutSlot));
+    }
+    lc->arrange = m->pertag->layout[m->pertag->curtag]->arrange;
+    lc->mfact   = m->mfact;
+    lc->nmaster = m->nmaster;
+    lc->wx      = m->wx;
+    lc->wy      = m->wy;
+    lc->ww      = m->ww;
+    lc->wh      = m->wh;
+    lc->nslots  = m->ntiled;
+    memcpy(lc->ltsymbol, m->ltsymbol, sizeof lc->ltsymbol);
+    for (i = 0; i < m->ntiled; i++) {
+        c           = m->tiled[i];
+        s           = &lc->slots[i];
+        s->id       = c->id;
+        s->cfact    = c->cfact;
+        s->hintsgen = c->hintsgen;
+        s->bw       = c->bw;
+        s->x        = c->x;
+        s->y        = c->y;
+        s->w        = c->w;
+        s->h        = c->h;
+        s->pbw      = c->pbw;
+    }
 }
 
 void scan(void) {
     unsigned int i, num;
     Window d1, d2, *wins = NULL;
-    XWindowAttributes wa;
+    PropRequest* reqs;
+    WinProps* props;
+    struct timespec start, end;
 
-    if (XQueryTree(dpy, root, &d1, &d2, &wins, &num)) {
-        for (i = 0; i < num; i++) {
-            if (!XGetWindowAttributes(dpy, wins[i], &wa)
-                || wa.override_redirect || XGetTransientForHint(dpy, wins[i], &d1))
-                continue;
-            if (wa.map_state == IsViewable || getstate(wins[i]) == IconicState)
-                manage(wins[i], &wa);
+    if (!XQueryTree(dpy, root, &d1, &d2, &wins, &num))
+        return;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    reqs  = ecalloc(num ? num : 1, sizeof(PropRequest));
+    props = ecalloc(num ? num : 1, sizeof(WinProps));
+    /* pipeline the requests for all windows before reading the first reply */
+    for (i = 0; i < num; i++)
+        requestprops(wins[i], &reqs[i]);
+    for (i = 0; i < num; i++)
+        if (!readprops(&reqs[i], &props[i]))
+            props[i].wa.override_redirect = True; /* gone, skip it */
+    scanner = 1;
+    for (i = 0; i < num; i++) {
+        if (props[i].wa.override_redirect || props[i].trans != None)
+            continue;
+        if (props[i].wa.map_state == IsViewable || props[i].wmstate == IconicState) {
+            manage(wins[i], &props[i]);
+            stats.scanned++;
         }
-        for (i = 0; i < num; i++) { /* now the transients */
-            if (!XGetWindowAttributes(dpy, wins[i], &wa))
-                continue;
-            if (XGetTransientForHint(dpy, wins[i], &d1)
-                && (wa.map_state == IsViewable || getstate(wins[i]) == IconicState))
-                manage(wins[i], &wa);
+    }
+    for (i = 0; i < num; i++) { /* now the transients */
+        if (props[i].wa.override_redirect)
+            continue;
+        if (props[i].trans != None
+            && (props[i].wa.map_state == IsViewable || props[i].wmstate == IconicState)) {
+            manage(wins[i], &props[i]);
+            stats.scanned++;
         }
-        if (wins)
-            XFree(wins);
     }
+    scanner = 0;
+    focus(NULL);
+    flushpending();
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    stats.scanns  = (end.tv_sec - start.tv_sec) * 1000000000UL + end.tv_nsec - start.tv_nsec;
+    free(reqs);
+    free(props);
+    if (wins)
+        XFree(wins);
 }
 
 void sendmon(Client* c, Monitor* m) {
     if (c->mon == m)
         return;
     for (unsigned int tag = 0; tag < 9; tag++) {
-        c->fx[tag] = c->fx[tag] - c->mon->mx + m->mx;
-        c->fy[tag] = c->fy[tag] - c->mon->my + m->my;
+        c->cold->fx[tag] = c->cold->fx[tag] - c->mon->mx + m->mx;
+        c->cold->fy[tag] = c->cold->fy[tag] - c->mon->my + m->my;
     }
     unfocus(c, 1);
     detach(c);
     detachstack(c);
     c->mon  = m;
     c->tags = (m->tagset[m->seltags] ? m->tagset[m->seltags] : 1); /* assign tags of target monitor */
+    c->stackpos = 0; /* its place was among the windows of the old monitor */
+    if (c->frame)
+        setframe(c, TAGFRAME(m, c->tags));
     attach(c);
     attachstack(c);
     focus(c);
@@ -1203,7 +2029,7 @@ void setattach(const Arg* arg) {
     if (arg->i >= 0)
         attachmode = arg->i;
     selmon->attachmode = attachmode % AttachModes;
-    drawbars();
+    markdirty(NULL, DirtyBar);
 }
 
 void setclientstate(Client* c, long state) {
@@ -1214,16 +2040,9 @@ void setclientstate(Client* c, long state) {
 }
 
 int sendevent(Client* c, Atom proto) {
-    int n;
-    Atom* protocols;
-    int exists = 0;
+    int exists = (c->protocols & protocolbit(proto)) != 0;
     XEvent ev;
 
-    if (XGetWMProtocols(dpy, c->win, &protocols, &n)) {
-        while (!exists && n--)
-            exists = protocols[n] == proto;
-        XFree(protocols);
-    }
     if (exists) {
         ev.type                 = ClientMessage;
         ev.xclient.window       = c->win;
@@ -1247,21 +2066,49 @@ void setfocus(Client* c) {
     sendevent(c, wmatom[WMTakeFocus]);
 }
 
+/* moves c into frame, a tag container of c->mon, or to the root window if
+ * frame is None, keeping its place on screen relative to the monitor */
+void setframe(Client* c, Window frame) {
+    int x = c->sent.x, y = c->sent.y;
+
+    if (!c->frame) {
+        x -= c->mon->mx;
+        y -= c->mon->my;
+    }
+    if (!frame) {
+        x += c->mon->mx;
+        y += c->mon->my;
+    }
+    if (!c->iconic) {
+        /* the old parent still reports the unmap, unmapnotify() skips it */
+        XSelectInput(dpy, c->win, CLIENTMASK & ~StructureNotifyMask);
+        c->ignoreunmap++;
+    }
+    XReparentWindow(dpy, c->win, frame ? frame : root, x, y);
+    if (!c->iconic)
+        XSelectInput(dpy, c->win, CLIENTMASK);
+    c->frame    = frame;
+    c->sent.x   = x;
+    c->sent.y   = y;
+    c->stackpos = 0; /* on top of its new siblings */
+}
+
 void setfullscreen(Client* c, int fullscreen) {
     if (fullscreen && !c->isfullscreen) {
-        XChangeProperty(dpy, c->win, netatom[NetWMState], XA_ATOM, 32,
-            PropModeReplace, (unsigned char*)&netatom[NetWMFullscreen], 1);
+        c->cold->wstate       = netatom[NetWMFullscreen];
         c->isfullscreen = 1;
+        updatewmstate(c);
         c->oldstate     = c->isfloating;
         c->oldbw        = c->bw;
         c->bw           = 0;
         c->isfloating   = 1;
         resizeclient(c, c->mon->mx, c->mon->my, c->mon->mw, c->mon->mh);
-        XRaiseWindow(dpy, c->win);
+        raiseclient(c);
+        markdirty(c->mon, DirtyStack);
     } else if (!fullscreen && c->isfullscreen) {
-        XChangeProperty(dpy, c->win, netatom[NetWMState], XA_ATOM, 32,
-            PropModeReplace, (unsigned char*)0, 0);
+        c->cold->wstate       = None;
         c->isfullscreen = 0;
+        updatewmstate(c);
         c->isfloating   = c->oldstate;
         c->bw           = c->oldbw;
         c->x            = c->oldx;
@@ -1282,7 +2129,7 @@ void setlayout(const Arg* arg) {
     if (selmon->sel)
         arrange(selmon);
     else
-        drawbar(selmon);
+        markdirty(selmon, DirtyBar);
 }
 
 void setcfact(const Arg* arg) {
@@ -1315,15 +2162,99 @@ void setmfact(const Arg* arg) {
     arrange(selmon);
 }
 
+void setsizehints(Client* c, XSizeHints* size) {
+    c->hintsgen++;
+    c->mon->staletags |= c->tags;
+    if (size->flags & PBaseSize) {
+        c->basew = size->base_width;
+        c->baseh = size->base_height;
+    } else if (size->flags & PMinSize) {
+        c->basew = size->min_width;
+        c->baseh = size->min_height;
+    } else
+        c->basew = c->baseh = 0;
+    if (size->flags & PResizeInc) {
+        c->incw = size->width_inc;
+        c->inch = size->height_inc;
+    } else
+        c->incw = c->inch = 0;
+    if (size->flags & PMaxSize) {
+        c->maxw = size->max_width;
+        c->maxh = size->max_height;
+    } else
+        c->maxw = c->maxh = 0;
+    if (size->flags & PMinSize) {
+        c->minw = size->min_width;
+        c->minh = size->min_height;
+    } else if (size->flags & PBaseSize) {
+        c->minw = size->base_width;
+        c->minh = size->base_height;
+    } else
+        c->minw = c->minh = 0;
+    if (size->flags & PAspect) {
+        c->mina = (float)size->min_aspect.y / size->min_aspect.x;
+        c->maxa = (float)size->max_aspect.x / size->max_aspect.y;
+    } else
+        c->maxa = c->mina = 0.0;
+    c->isfixed = (c->maxw && c->maxh && c->maxw == c->minw && c->maxh == c->minh);
+}
+
+void settags(Client* c, unsigned int tags) {
+    counttags(c, -1);
+    c->mon->staletags |= c->tags | tags;
+    c->tags = tags;
+    counttags(c, 1);
+}
+
+void settimeout(void (*func)(void), unsigned int ms) {
+    struct timespec now;
+    int i, slot = -1;
+
+    for (i = 0; i < MAXTIMERS; i++)
+        if (timers[i].func == func || (slot == -1 && !timers[i].func))
+            slot = i;
+    if (slot == -1)
+        die("dwm: too many timers");
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    timers[slot].func        = func;
+    timers[slot].due.tv_sec  = now.tv_sec + ms / 1000;
+    timers[slot].due.tv_nsec = now.tv_nsec + (ms % 1000) * 1000000L;
+    if (timers[slot].due.tv_nsec >= 1000000000L) {
+        timers[slot].due.tv_sec++;
+        timers[slot].due.tv_nsec -= 1000000000L;
+    }
+    armtimers();
+}
+
 void setup(void) {
     int i;
     XSetWindowAttributes wa;
     Atom utf8string;
-
+    sigset_t sigmask;
+
+    /* signals, timers and the X connection are all read by the epoll loop in run() */
+    sigemptyset(&sigmask);
+    sigaddset(&sigmask, SIGCHLD);
+    sigaddset(&sigmask, SIGHUP);
+    sigaddset(&sigmask, SIGTERM);
+    sigaddset(&sigmask, SIGUSR1);
+    if (sigprocmask(SIG_BLOCK, &sigmask, &origsigmask) == -1)
+        die("sigprocmask:");
+    if ((sigfd = signalfd(-1, &sigmask, SFD_NONBLOCK | SFD_CLOEXEC)) == -1)
+        die("signalfd:");
+    if ((timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) == -1)
+        die("timerfd_create:");
+    if ((epollfd = epoll_create1(EPOLL_CLOEXEC)) == -1)
+        die("epoll_create1:");
+    watchfd(ConnectionNumber(dpy));
+    watchfd(sigfd);
+    watchfd(timerfd);
     /* clean up any zombies immediately */
-    sigchld(0);
+    while (0 < waitpid(-1, NULL, WNOHANG))
+        ;
 
     /* init screen */
+    xcon   = XGetXCBConnection(dpy);
     screen = DefaultScreen(dpy);
     sw     = DisplayWidth(dpy, screen);
     sh     = DisplayHeight(dpy, screen);
@@ -1349,9 +2280,11 @@ void setup(void) {
     netatom[NetWMState]            = XInternAtom(dpy, "_NET_WM_STATE", False);
     netatom[NetWMCheck]            = XInternAtom(dpy, "_NET_SUPPORTING_WM_CHECK", False);
     netatom[NetWMFullscreen]       = XInternAtom(dpy, "_NET_WM_STATE_FULLSCREEN", False);
+    netatom[NetWMHidden]           = XInternAtom(dpy, "_NET_WM_STATE_HIDDEN", False);
     netatom[NetWMWindowType]       = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE", False);
     netatom[NetWMWindowTypeDialog] = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE_DIALOG", False);
     netatom[NetClientList]         = XInternAtom(dpy, "_NET_CLIENT_LIST", False);
+    netatom[NetClientListStacking] = XInternAtom(dpy, "_NET_CLIENT_LIST_STACKING", False);
     /* init cursors */
     cursor[CurNormal]            = drw_cur_create(drw, XC_left_ptr);
     cursor[CurResizeTopLeft]     = drw_cur_create(drw, XC_top_left_corner);
@@ -1378,6 +2311,7 @@ void setup(void) {
     XChangeProperty(dpy, root, netatom[NetSupported], XA_ATOM, 32,
         PropModeReplace, (unsigned char*)netatom, NetLast);
     XDeleteProperty(dpy, root, netatom[NetClientList]);
+    XDeleteProperty(dpy, root, netatom[NetClientListStacking]);
     /* select events */
     wa.cursor     = cursor[CurNormal]->cursor;
     wa.event_mask = SubstructureRedirectMask | SubstructureNotifyMask
@@ -1385,6 +2319,7 @@ void setup(void) {
         | LeaveWindowMask | StructureNotifyMask | PropertyChangeMask;
     XChangeWindowAttributes(dpy, root, CWEventMask | CWCursor, &wa);
     XSelectInput(dpy, root, wa.event_mask);
+    updatenumlockmask();
     grabkeys();
     focus(NULL);
 }
@@ -1393,37 +2328,101 @@ void seturgent(Client* c, int urg) {
     if (c->isurgent == urg)
         return;
 
-    XWMHints* wmh;
-
+    counttags(c, -1);
     c->isurgent = urg;
-    if (!(wmh = XGetWMHints(dpy, c->win)))
+    counttags(c, 1);
+    if (!c->cold->haswmh)
         return;
-    wmh->flags = urg ? (wmh->flags | XUrgencyHint) : (wmh->flags & ~XUrgencyHint);
-    XSetWMHints(dpy, c->win, wmh);
-    XFree(wmh);
+    c->cold->wmh.flags = urg ? (c->cold->wmh.flags | XUrgencyHint) : (c->cold->wmh.flags & ~XUrgencyHint);
+    XSetWMHints(dpy, c->win, &c->cold->wmh);
 }
 
-void showhide(Client* c) {
-    if (!c)
-        return;
-    if (ISVISIBLE(c) && !ISHIDDEN(c)) {
-        /* show clients top down */
-        XMoveWindow(dpy, c->win, c->x, c->y);
-        if ((c->mon->pertag->layout[c->mon->pertag->curtag]->arrange == layout_float || c->isfloating) && !c->isfullscreen)
-            resize(c, c->x, c->y, c->w, c->h, 0);
-        showhide(c->snext);
+void setwindowtype(Client* c, Atom state, Atom wtype) {
+    c->cold->wstate = state;
+    c->cold->wtype  = wtype;
+    if (state == netatom[NetWMFullscreen])
+        setfullscreen(c, 1);
+    if (wtype == netatom[NetWMWindowTypeDialog])
+        c->isfloating = 1;
+}
+
+void setwmhints(Client* c, XWMHints* wmh) {
+    c->cold->wmh    = *wmh;
+    c->cold->haswmh = 1;
+    if (c == selmon->sel && c->cold->wmh.flags & XUrgencyHint) {
+        c->cold->wmh.flags &= ~XUrgencyHint;
+        XSetWMHints(dpy, c->win, &c->cold->wmh);
     } else {
-        /* hide clients bottom up */
-        showhide(c->snext);
-        XMoveWindow(dpy, c->win, WIDTH(c) * -2, c->y);
+        counttags(c, -1);
+        c->isurgent = (c->cold->wmh.flags & XUrgencyHint) ? 1 : 0;
+        counttags(c, 1);
     }
+    if (c->cold->wmh.flags & InputHint)
+        c->neverfocus = !c->cold->wmh.input;
+    else
+        c->neverfocus = 0;
 }
 
-void sigchld(int unused) {
-    if (signal(SIGCHLD, sigchld) == SIG_ERR)
-        die("can't install SIGCHLD handler:");
-    while (0 < waitpid(-1, NULL, WNOHANG))
-        ;
+/* Moves the clients of m whose visibility changed since the last call on or
+ * off screen. Clients which stay visible are left to commitgeometry(). With
+ * tagframes the visible clients are gathered in the frame of the first
+ * viewed tag, which replaces the frame mapped before, and the rest are only
+ * touched if they were in that frame or are hidden. */
+void showhide(Monitor* m) {
+    Client* c;
+    int cur      = ffs(m->tagset[m->seltags]) - 1;
+    Window frame = tagframes && cur >= 0 ? m->frames[cur] : None;
+
+    /* show clients top down */
+    for (c = m->stack; c; c = c->snext) {
+        if (!ISVISIBLE(c) || ISHIDDEN(c))
+            continue;
+        if (tagframes && c->frame != (INFRAME(c) ? frame : None))
+            setframe(c, INFRAME(c) ? frame : None);
+        if (c->shown)
+            continue;
+        c->shown = 1;
+        if ((m->pertag->layout[m->pertag->curtag]->arrange == layout_float || c->isfloating) && !c->isfullscreen)
+            resize(c, c->x, c->y, c->w, c->h, 0);
+        commitclient(c);
+        if (c->iconic) {
+            /* map after the move, so the old geometry never flashes */
+            c->iconic = 0;
+            XMapWindow(dpy, c->win);
+            setclientstate(c, NormalState);
+            updatewmstate(c);
+            if (c == selmon->sel) /* focus() came before the map */
+                setfocus(c);
+        }
+    }
+    /* hide clients bottom up */
+    for (c = m->stail; c; c = c->sprev) {
+        if (ISVISIBLE(c) && !ISHIDDEN(c))
+            continue;
+        if (tagframes && !ISVISIBLE(c) && INFRAME(c)) {
+            if (c->frame == frame)
+                setframe(c, TAGFRAME(m, c->tags));
+            continue;
+        }
+        if (hideunmap && !c->iconic)
+            hideclient(c);
+        else if (!hideunmap && c->shown) {
+            XMoveWindow(dpy, c->win, WIDTH(c) * -2, c->y - FRAMEY(c));
+            c->sent.x = WIDTH(c) * -2;
+            c->sent.y = c->y - FRAMEY(c);
+        }
+        c->shown = 0;
+    }
+    if (tagframes && cur != m->curframe) {
+        if (frame)
+            XMapWindow(dpy, frame);
+        if (m->curframe >= 0)
+            XUnmapWindow(dpy, m->frames[m->curframe]);
+        m->curframe = cur;
+        m->frameup  = -1;
+        if (m == selmon && m->sel) /* focus() came before the map */
+            setfocus(m->sel);
+    }
 }
 
 void spawn(const Arg* arg) {
@@ -1432,6 +2431,7 @@ void spawn(const Arg* arg) {
     if (fork() == 0) {
         if (dpy)
             close(ConnectionNumber(dpy));
+        sigprocmask(SIG_SETMASK, &origsigmask, NULL);
         setsid();
         execvp(((char**)arg->v)[0], (char**)arg->v);
         fprintf(stderr, "dwm: execvp %s", ((char**)arg->v)[0]);
@@ -1440,9 +2440,33 @@ void spawn(const Arg* arg) {
     }
 }
 
+/* Keeps the mapped frame of m below the bar, like tiled clients without
+ * frames, unless it shows a fullscreen client. That one goes on top, above
+ * the floating clients as well. */
+void stackframe(Monitor* m) {
+    XWindowChanges wc;
+    Client* c;
+    int up = 0;
+
+    if (m->curframe < 0)
+        return;
+    for (c = m->stack; c && !up; c = c->snext)
+        up = c->isfullscreen && ISVISIBLE(c) && !ISHIDDEN(c);
+    if (up == m->frameup)
+        return;
+    if (up)
+        XRaiseWindow(dpy, m->frames[m->curframe]);
+    else {
+        wc.sibling    = m->barwin;
+        wc.stack_mode = Below;
+        XConfigureWindow(dpy, m->frames[m->curframe], CWSibling | CWStackMode, &wc);
+    }
+    m->frameup = up;
+}
+
 void tag(const Arg* arg) {
     if (selmon->sel && arg->ui & TAGMASK) {
-        selmon->sel->tags = arg->ui & TAGMASK;
+        settags(selmon->sel, arg->ui & TAGMASK);
         focus(NULL);
         arrange(selmon);
     }
@@ -1462,7 +2486,7 @@ void togglefloating(const Arg* arg) {
     selmon->sel->isfloating = !selmon->sel->isfloating || selmon->sel->isfixed;
     if (selmon->sel->isfloating) {
         resize(selmon->sel, selmon->sel->x, selmon->sel->y, selmon->sel->w, selmon->sel->h, 0);
-        XRaiseWindow(dpy, selmon->sel->win);
+        raiseclient(selmon->sel);
     }
     arrange(selmon);
 }
@@ -1479,7 +2503,7 @@ void toggletag(const Arg* arg) {
         return;
     newtags = selmon->sel->tags ^ (arg->ui & TAGMASK);
     if (newtags) {
-        selmon->sel->tags = newtags;
+        settags(selmon->sel, newtags);
         focus(NULL);
         arrange(selmon);
     }
@@ -1509,9 +2533,10 @@ void toggleview(const Arg* arg) {
     selmon->mfact   = selmon->pertag->mfacts[selmon->pertag->curtag];
 
     // Update urgent status
-    for (Client* c = selmon->clients; c; c = c->next)
-        if (ISVISIBLE(c) && c->isurgent)
-            seturgent(c, 0);
+    if (selmon->urg & selmon->tagset[selmon->seltags])
+        for (Client* c = selmon->clients; c; c = c->next)
+            if (ISVISIBLE(c) && c->isurgent)
+                seturgent(c, 0);
 
     focus(NULL);
     arrange(selmon);
@@ -1532,6 +2557,7 @@ void unmanage(Client* c, int destroyed) {
     Monitor* m = c->mon;
     XWindowChanges wc;
 
+    winmap_remove(c->win);
     detach(c);
     detachstack(c);
     if (!destroyed) {
@@ -1540,14 +2566,20 @@ void unmanage(Client* c, int destroyed) {
         XSetErrorHandler(xerrordummy);
         XConfigureWindow(dpy, c->win, CWBorderWidth, &wc); /* restore border */
         XUngrabButton(dpy, AnyButton, AnyModifier, c->win);
+        if (c->frame) {
+            XReparentWindow(dpy, c->win, root, c->x, c->y);
+            XRemoveFromSaveSet(dpy, c->win);
+        }
         setclientstate(c, WithdrawnState);
-        XSync(dpy, False);
+        xsync();
         XSetErrorHandler(xerror);
         XUngrabServer(dpy);
     }
-    free(c);
+    clientwins[c->listpos] = None;
+    listsdirty |= ListClients;
+    pool_free(&coldpool, c->cold);
+    pool_free(&clientpool, c);
     focus(NULL);
-    updateclientlist();
     arrange(m);
 }
 
@@ -1556,23 +2588,95 @@ void unmapnotify(XEvent* e) {
     XUnmapEvent* ev = &e->xunmap;
 
     if ((c = wintoclient(ev->window))) {
-        if (ev->send_event)
+        if (!ev->send_event && c->ignoreunmap)
+            c->ignoreunmap--;
+        else if (ev->send_event && !c->iconic)
             setclientstate(c, WithdrawnState);
-        else
+        else /* a withdrawing iconic client only sends the synthetic event */
             unmanage(c, 0);
     }
 }
 
-void updateclientlist() {
+void updateclass(Client* c) {
+    XClassHint ch = { NULL, NULL };
+
+    c->cold->class[0] = c->cold->instance[0] = '\0';
+    if (!XGetClassHint(dpy, c->win, &ch))
+        return;
+    if (ch.res_class) {
+        snprintf(c->cold->class, sizeof c->cold->class, "%s", ch.res_class);
+        XFree(ch.res_class);
+    }
+    if (ch.res_name) {
+        snprintf(c->cold->instance, sizeof c->cold->instance, "%s", ch.res_name);
+        XFree(ch.res_name);
+    }
+}
+
+void updateclientlist(void) {
     Client* c;
     Monitor* m;
+    unsigned int i, n = 0, nraised = 0;
+
+    if (listsdirty & ListClients) {
+        /* close the gaps unmanage() left */
+        for (i = 0; i < nclientwins; i++)
+            if (clientwins[i] && (c = wintoclient(clientwins[i]))) {
+                c->listpos      = n;
+                clientwins[n++] = c->win;
+            }
+        nclientwins = n;
+        XChangeProperty(dpy, root, netatom[NetClientList], XA_WINDOW, 32,
+            PropModeReplace, (unsigned char*)clientwins, nclientwins);
+    }
+    if (listsdirty & ListStacking) {
+        /* bottom to top: clients not shown, the tiled ones restackmon() keeps
+         * below the bars in its order, the rest in the order they were
+         * raised above everything */
+        n = 0;
+        for (m = mons; m; m = m->next)
+            for (c = m->stail; c; c = c->sprev)
+                if (!ISVISIBLE(c) || ISHIDDEN(c))
+                    stackingwins[n++] = c->win;
+        for (m = mons; m; m = m->next)
+            for (c = m->stail; c; c = c->sprev)
+                if (ISVISIBLE(c) && !ISHIDDEN(c)) {
+                    if (c->isfloating || m->pertag->layout[m->pertag->curtag]->arrange == layout_float)
+                        raisedclients[nraised++] = c;
+                    else
+                        stackingwins[n++] = c->win;
+                }
+        qsort(raisedclients, nraised, sizeof(Client*), raisedcmp);
+        for (i = 0; i < nraised; i++)
+            stackingwins[n++] = raisedclients[i]->win;
+        XChangeProperty(dpy, root, netatom[NetClientListStacking], XA_WINDOW, 32,
+            PropModeReplace, (unsigned char*)stackingwins, n);
+    }
+    listsdirty = 0;
+}
+
+/* Each tag of m gets a frame covering the monitor, the clients of the viewed
+ * tags are reparented into one of them by showhide(). Frames select no input
+ * events, so clicks on empty parts of the screen still reach the root. */
+void updateframes(Monitor* m) {
+    XSetWindowAttributes wa = {
+        .override_redirect = True,
+        .background_pixmap = ParentRelative, /* the root's, nothing stale in gaps */
+        .event_mask        = SubstructureRedirectMask | SubstructureNotifyMask
+    };
+    int i;
 
-    XDeleteProperty(dpy, root, netatom[NetClientList]);
-    for (m = mons; m; m = m->next)
-        for (c = m->clients; c; c = c->next)
-            XChangeProperty(dpy, root, netatom[NetClientList],
-                XA_WINDOW, 32, PropModeAppend,
-                (unsigned char*)&(c->win), 1);
+    for (i = 0; i < ntags; i++) {
+        if (m->frames[i]) {
+            XMoveResizeWindow(dpy, m->frames[i], m->mx, m->my, m->mw, m->mh);
+            continue;
+        }
+        m->frames[i] = XCreateWindow(dpy, root, m->mx, m->my, m->mw, m->mh, 0,
+            CopyFromParent, InputOutput, CopyFromParent,
+            CWOverrideRedirect | CWBackPixmap | CWEventMask, &wa);
+        m->framemarks[i] = XCreateWindow(dpy, m->frames[i], 0, 0, 1, 1, 0,
+            0, InputOnly, CopyFromParent, 0, NULL);
+    }
 }
 
 int updategeom(void) {
@@ -1614,16 +2718,21 @@ int updategeom(void) {
                     m->mw = m->ww = unique[i].width;
                     m->mh = m->wh = unique[i].height;
                     updatebarpos(m);
+                    if (tagframes)
+                        updateframes(m);
                 }
         } else { /* less monitors available nn < n */
             for (i = nn; i < n; i++) {
                 for (m = mons; m && m->next; m = m->next)
                     ;
                 while ((c = m->clients)) {
-                    dirty      = 1;
-                    m->clients = c->next;
+                    dirty = 1;
+                    detach(c);
                     detachstack(c);
-                    c->mon = mons;
+                    c->mon      = mons;
+                    c->stackpos = 0;
+                    if (c->frame)
+                        setframe(c, TAGFRAME(mons, c->tags));
                     attach(c);
                     attachstack(c);
                 }
@@ -1641,6 +2750,8 @@ int updategeom(void) {
             mons->mw = mons->ww = sw;
             mons->mh = mons->wh = sh;
             updatebarpos(mons);
+            if (tagframes)
+                updateframes(mons);
         }
     }
     if (dirty) {
@@ -1664,6 +2775,18 @@ void updatenumlockmask(void) {
     XFreeModifiermap(modmap);
 }
 
+void updateprotocols(Client* c) {
+    Atom* protocols;
+    int n;
+
+    c->protocols = 0;
+    if (XGetWMProtocols(dpy, c->win, &protocols, &n)) {
+        while (n--)
+            c->protocols |= protocolbit(protocols[n]);
+        XFree(protocols);
+    }
+}
+
 void updatesizehints(Client* c) {
     long msize;
     XSizeHints size;
@@ -1671,78 +2794,80 @@ void updatesizehints(Client* c) {
     if (!XGetWMNormalHints(dpy, c->win, &size, &msize))
         /* size is uninitialized, ensure that size.flags aren't used */
         size.flags = PSize;
-    if (size.flags & PBaseSize) {
-        c->basew = size.base_width;
-        c->baseh = size.base_height;
-    } else if (size.flags & PMinSize) {
-        c->basew = size.min_width;
-        c->baseh = size.min_height;
-    } else
-        c->basew = c->baseh = 0;
-    if (size.flags & PResizeInc) {
-        c->incw = size.width_inc;
-        c->inch = size.height_inc;
-    } else
-        c->incw = c->inch = 0;
-    if (size.flags & PMaxSize) {
-        c->maxw = size.max_width;
-        c->maxh = size.max_height;
-    } else
-        c->maxw = c->maxh = 0;
-    if (size.flags & PMinSize) {
-        c->minw = size.min_width;
-        c->minh = size.min_height;
-    } else if (size.flags & PBaseSize) {
-        c->minw = size.base_width;
-        c->minh = size.base_height;
-    } else
-        c->minw = c->minh = 0;
-    if (size.flags & PAspect) {
-        c->mina = (float)size.min_aspect.y / size.min_aspect.x;
-        c->maxa = (float)size.max_aspect.x / size.max_aspect.y;
-    } else
-        c->maxa = c->mina = 0.0;
-    c->isfixed = (c->maxw && c->maxh && c->maxw == c->minw && c->maxh == c->minh);
+    setsizehints(c, &size);
 }
 
 void updatestatus(void) {
     if (!gettextprop(root, XA_WM_NAME, stext, sizeof(stext)))
         strcpy(stext, "dwm");
-    drawbar(selmon);
+    markdirty(selmon, DirtyBar);
+}
+
+/* Fills m->tiled, m->ntiled, m->tiledtail and the tiledpos of each of
+ * them with the tiled clients of the view. Anything that changes which
+ * clients those are, or their order, arranges m, so they are current
+ * whenever m is not marked DirtyLayout, and only then may they be read
+ * outside arrangemon(). */
+void updatetiled(Monitor* m) {
+    Client* c;
+
+    m->ntiled = 0;
+    for (c = nexttiled(m->clients); c; c = nexttiled(c->next)) {
+        if (m->ntiled == m->tiledsize) {
+            m->tiledsize = m->tiledsize ? 2 * m->tiledsize : 16;
+            m->tiled     = erealloc(m->tiled, m->tiledsize * sizeof(Client*));
+            m->tilein    = erealloc(m->tilein, m->tiledsize * sizeof(TileClient));
+            m->tileout   = erealloc(m->tileout, m->tiledsize * sizeof(TileRect));
+        }
+        c->tiledpos           = m->ntiled;
+        m->tiled[m->ntiled++] = c;
+    }
+    m->tiledtail = m->ntiled ? m->tiled[m->ntiled - 1] : NULL;
 }
 
 void updatetitle(Client* c) {
-    if (!gettextprop(c->win, netatom[NetWMName], c->name, sizeof c->name))
-        gettextprop(c->win, XA_WM_NAME, c->name, sizeof c->name);
-    if (c->name[0] == '\0') /* hack to mark broken clients */
-        strcpy(c->name, broken);
+    if (!gettextprop(c->win, netatom[NetWMName], c->cold->name, sizeof c->cold->name))
+        gettextprop(c->win, XA_WM_NAME, c->cold->name, sizeof c->cold->name);
+    if (c->cold->name[0] == '\0') /* hack to mark broken clients */
+        strcpy(c->cold->name, broken);
 }
 
+/* _NET_WM_STATE is only changed through dwm once the client is managed, so
+ * the cached one is current and only the type is read again */
 void updatewindowtype(Client* c) {
-    Atom state = getatomprop(c, netatom[NetWMState]);
     Atom wtype = getatomprop(c, netatom[NetWMWindowType]);
 
-    if (state == netatom[NetWMFullscreen])
-        setfullscreen(c, 1);
-    if (wtype == netatom[NetWMWindowTypeDialog])
-        c->isfloating = 1;
+    if (wtype != c->cold->wtype)
+        setwindowtype(c, c->cold->wstate, wtype);
 }
 
 void updatewmhints(Client* c) {
     XWMHints* wmh;
 
     if ((wmh = XGetWMHints(dpy, c->win))) {
-        if (c == selmon->sel && wmh->flags & XUrgencyHint) {
-            wmh->flags &= ~XUrgencyHint;
-            XSetWMHints(dpy, c->win, wmh);
-        } else
-            c->isurgent = (wmh->flags & XUrgencyHint) ? 1 : 0;
-        if (wmh->flags & InputHint)
-            c->neverfocus = !wmh->input;
-        else
-            c->neverfocus = 0;
+        setwmhints(c, wmh);
         XFree(wmh);
-    }
+    } else
+        c->cold->haswmh = c->cold->wmh.flags = 0;
+}
+
+void updatewmstate(Client* c) {
+    Atom state[2];
+    int n = 0;
+
+    if (c->isfullscreen)
+        state[n++] = netatom[NetWMFullscreen];
+    if (c->iconic)
+        state[n++] = netatom[NetWMHidden];
+    XChangeProperty(dpy, c->win, netatom[NetWMState], XA_ATOM, 32,
+        PropModeReplace, (unsigned char*)state, n);
+}
+
+void watchfd(int fd) {
+    struct epoll_event ev = { .events = EPOLLIN, .data.fd = fd };
+
+    if (epoll_ctl(epollfd, EPOLL_CTL_ADD, fd, &ev) == -1)
+        die("epoll_ctl:");
 }
 
 void view(const Arg* arg) {
@@ -1751,6 +2876,8 @@ void view(const Arg* arg) {
 
     if ((arg->ui & TAGMASK) == selmon->tagset[selmon->seltags])
         return;
+    clock_gettime(CLOCK_MONOTONIC, &viewstart);
+    viewserial = NextRequest(dpy);
     selmon->seltags ^= 1; /* toggle sel tagset */
     if (arg->ui & TAGMASK) {
         selmon->tagset[selmon->seltags] = arg->ui & TAGMASK;
@@ -1773,9 +2900,10 @@ void view(const Arg* arg) {
     selmon->mfact   = selmon->pertag->mfacts[selmon->pertag->curtag];
 
     // Update urgent status
-    for (Client* c = selmon->clients; c; c = c->next)
-        if (ISVISIBLE(c) && c->isurgent)
-            seturgent(c, 0);
+    if (selmon->urg & selmon->tagset[selmon->seltags])
+        for (Client* c = selmon->clients; c; c = c->next)
+            if (ISVISIBLE(c) && c->isurgent)
+                seturgent(c, 0);
 
     focus(NULL);
     arrange(selmon);
@@ -1783,29 +2911,20 @@ void view(const Arg* arg) {
 
 Client*
 wintoclient(Window w) {
-    Client* c;
-    Monitor* m;
+    WinEntry* e = winmap_find(w);
 
-    for (m = mons; m; m = m->next)
-        for (c = m->clients; c; c = c->next)
-            if (c->win == w)
-                return c;
-    return NULL;
+    return e ? e->c : NULL;
 }
 
 Monitor*
 wintomon(Window w) {
     int x, y;
-    Client* c;
-    Monitor* m;
+    WinEntry* e;
 
     if (w == root && getrootptr(&x, &y))
         return recttomon(x, y, 1, 1);
-    for (m = mons; m; m = m->next)
-        if (w == m->barwin)
-            return m;
-    if ((c = wintoclient(w)))
-        return c->mon;
+    if ((e = winmap_find(w)))
+        return e->m ? e->m : e->c->mon;
     return selmon;
 }
 
@@ -1860,6 +2979,13 @@ int xerrorstart(Display* dpy, XErrorEvent* ee) {
     return -1;
 }
 
+/* every XSync() should go through here to be counted, other round-trips
+ * (replies to requests) are not */
+void xsync(void) {
+    stats.syncs++;
+    XSync(dpy, False);
+}
+
 void zoom(const Arg* arg) {
     Client* c = (Client*)arg->v;
     if (!c)
@@ -1871,11 +2997,8 @@ void zoom(const Arg* arg) {
     if (c == nexttiled(selmon->clients))
         if (!c || !(c = nexttiled(c->next)))
             return;
-    int attachmode     = selmon->attachmode;
     detach(c);
-    selmon->attachmode = AttachFront;
-    attach(c);
-    selmon->attachmode = attachmode;
+    attachbefore(c, c->mon->clients);
     focus(c);
     arrange(c->mon);
 }
@@ -1903,7 +3026,7 @@ int main(int argc, char* argv[]) {
 }
 
 void movestack(const Arg* arg) {
-    Client *c = NULL, *p = NULL, *pc = NULL, *i;
+    Client *c = NULL, *sel, *next;
 
     if (arg->i > 0) {
         /* find the client after selmon->sel */
@@ -1915,38 +3038,29 @@ void movestack(const Arg* arg) {
 
     } else {
         /* find the client before selmon->sel */
-        for (i = selmon->clients; i != selmon->sel; i = i->next)
-            if (ISVISIBLE(i) && !i->isfloating && !ISHIDDEN(i))
-                c = i;
+        for (c = selmon->sel->prev; c && (!ISVISIBLE(c) || c->isfloating || ISHIDDEN(c)); c = c->prev)
+            ;
         if (!c)
-            for (; i; i = i->next)
-                if (ISVISIBLE(i) && !i->isfloating && !ISHIDDEN(i))
-                    c = i;
-    }
-    /* find the client before selmon->sel and c */
-    for (i = selmon->clients; i && (!p || !pc); i = i->next) {
-        if (i->next == selmon->sel)
-            p = i;
-        if (i->next == c)
-            pc = i;
+            for (c = selmon->tail; c && (!ISVISIBLE(c) || c->isfloating || ISHIDDEN(c)); c = c->prev)
+                ;
     }
 
-    /* swap c and selmon->sel selmon->clients in the selmon->clients list */
+    /* swap c and selmon->sel in the selmon->clients list */
     if (c && c != selmon->sel) {
-        Client* temp      = selmon->sel->next == c ? selmon->sel : selmon->sel->next;
-        selmon->sel->next = c->next == selmon->sel ? c : c->next;
-        c->next           = temp;
-
-        if (p && p != c)
-            p->next = c;
-        if (pc && pc != selmon->sel)
-            pc->next = selmon->sel;
-
-        if (selmon->sel == selmon->clients)
-            selmon->clients = c;
-        else if (c == selmon->clients)
-            selmon->clients = selmon->sel;
-
+        sel = selmon->sel;
+        if (sel->next == c) {
+            detach(c);
+            attachbefore(c, sel);
+        } else if (c->next == sel) {
+            detach(sel);
+            attachbefore(sel, c);
+        } else {
+            next = sel->next;
+            detach(sel);
+            attachbefore(sel, c);
+            detach(c);
+            attachbefore(c, next);
+        }
         arrange(selmon);
     }
 }
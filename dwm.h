@@ -2,8 +2,12 @@
 #define DWM_H
 
 #include "drw.h"
+#include "props.h"
+#include "tiling.h"
+#include <X11/XKBlib.h>
 #include <X11/Xatom.h>
 #include <X11/Xft/Xft.h>
+#include <X11/Xlib-xcb.h>
 #include <X11/Xlib.h>
 #include <X11/Xproto.h>
 #include <X11/Xutil.h>
@@ -15,11 +19,17 @@
 #include <math.h>
 #include <signal.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
 // clang-format off
@@ -30,23 +40,34 @@
                                * MAX(0, MIN((y)+(h),(m)->wy+(m)->wh) - MAX((y),(m)->wy)))
 #define ISVISIBLE(C)            (C->tags & C->mon->tagset[C->mon->seltags])
 #define ISHIDDEN(C)             (C->hidden && !C->mon->showhidden)
+#define TAGFRAME(M, T)          ((M)->frames[(T) ? ffs(T) - 1 : 0])
+#define INFRAME(C)              (!(C)->isfloating || (C)->isfullscreen) /* floating clients stay on root */
+#define FRAMEX(C)               (C->frame ? C->mon->mx : 0)
+#define FRAMEY(C)               (C->frame ? C->mon->my : 0)
 #define LENGTH(X)               (sizeof X / sizeof X[0])
+#define CLIENTMASK              (EnterWindowMask|FocusChangeMask|PropertyChangeMask|StructureNotifyMask)
 #define MOUSEMASK               (BUTTONMASK|PointerMotionMask)
 #define WIDTH(X)                ((X)->w + 2 * (X)->bw + gappx)
 #define HEIGHT(X)               ((X)->h + 2 * (X)->bw + gappx)
 #define TAGMASK                 ((1 << 9) - 1)
+#define MAXTIMERS               8
+#define PREARRANGEDELAY         200 /* ms without layout changes before prearrange() */
+#define EVBATCH                 256
 #define TEXTW(X)                (drw_fontset_getwidth(drw, (X)) + lrpad)
 
 /* enums */
 enum { CurNormal, CurResizeTopLeft, CurResizeTopRight, CurResizeBottomLeft, CurResizeBottomRight, CurMove, CurLast }; /* cursor */
 enum { SchemeNorm, SchemeSel, SchemeHidden, SchemeNotSel }; /* color schemes */
 enum { NetSupported, NetWMName, NetWMState, NetWMCheck,
-       NetWMFullscreen, NetActiveWindow, NetWMWindowType,
-       NetWMWindowTypeDialog, NetClientList, NetLast }; /* EWMH atoms */
+       NetWMFullscreen, NetWMHidden, NetActiveWindow, NetWMWindowType,
+       NetWMWindowTypeDialog, NetClientList, NetClientListStacking, NetLast }; /* EWMH atoms */
 enum { WMProtocols, WMDelete, WMState, WMTakeFocus, WMLast }; /* default atoms */
 enum { ClkTagBar, ClkLtSymbol, ClkAttach, ClkStatusText, ClkWinTitle,
        ClkClientWin, ClkRootWin, ClkLast }; /* clicks */
 enum { AttachFront, AttachStack, AttachEnd, AttachModes };
+enum { DirtyLayout = 1 << 0, DirtyStack = 1 << 1, DirtyBar = 1 << 2, DirtyScroll = 1 << 3 }; /* pending monitor work */
+enum { ListClients = 1 << 0, ListStacking = 1 << 1 }; /* root properties to publish */
+enum { GrabNone, GrabUnfocused, GrabFocused }; /* button grabs of a client */
 // clang-format on
 
 union Arg {
@@ -67,22 +88,50 @@ typedef struct {
 
 typedef struct Monitor Monitor;
 typedef struct Client Client;
-struct Client {
+/* state only needed for the bar, rules, hints and the floating layout */
+typedef struct {
     char name[256];
-    float mina, maxa;
-    float cfact;
-    int fx[10], fy[10], fw[10], fh[10];
+    char class[256], instance[256]; /* WM_CLASS, empty if unset */
+    XWMHints wmh; /* WM_HINTS, flags are 0 if unset */
+    int haswmh; /* WM_HINTS is set, maybe with no flags */
+    Atom wstate, wtype; /* first atom of _NET_WM_STATE and _NET_WM_WINDOW_TYPE */
+    int fx[10], fy[10], fw[10], fh[10]; /* floating geometry per tag */
+} ClientCold;
+
+/* fields used by nexttiled(), ISVISIBLE() and the layouts come first */
+struct Client {
+    Client *prev, *next; /* client list */
+    Monitor* mon;
+    unsigned int tags;
+    int isfloating, hidden, isfullscreen;
     int x, y, w, h;
-    int oldx, oldy, oldw, oldh;
+    int bw;
+    float cfact;
+    float mina, maxa;
     int basew, baseh, incw, inch, maxw, maxh, minw, minh;
-    int bw, oldbw;
-    unsigned int tags;
-    int isfixed, isfloating, isurgent, neverfocus, oldstate, isfullscreen;
-    int hidden;
-    Client* next;
-    Client* snext;
-    Monitor* mon;
+    int isfixed, isurgent, neverfocus, oldstate;
+    Client *sprev, *snext; /* focus stack */
     Window win;
+    int oldx, oldy, oldw, oldh;
+    int oldbw;
+    int pbw; /* border width resizeclient() chose, bw or 0 */
+    unsigned int stackpos, stackgen; /* place in the order of the last restackmon() of mon */
+    XWindowChanges sent; /* geometry last sent to the server, relative to frame */
+    int grabbed; /* buttons currently grabbed on win */
+    unsigned long id; /* never reused, unlike win; see LayoutCache */
+    unsigned int hintsgen; /* setsizehints() calls, see LayoutCache */
+    int shown; /* on screen after the last showhide() */
+    int iconic; /* unmapped by showhide() */
+    int ignoreunmap; /* UnmapNotify events caused by hideclient() and setframe() */
+    Window frame; /* tag container win is in, None for the root window */
+    int occluded; /* under the top client of monocle or deck, see markoccluded() */
+    unsigned int tiledpos; /* index in mon->tiled, if it is there */
+    unsigned int listpos; /* index in clientwins */
+    unsigned long raised; /* raiseclient() calls when it was last raised */
+    unsigned int protocols; /* protocolbit() of each WM_PROTOCOLS entry */
+    /* name, class, wmh and the window type are read in manage() and kept
+     * current by propertynotify() */
+    ClientCold* cold;
 };
 
 typedef struct {
@@ -97,6 +146,30 @@ typedef struct {
     void (*arrange)(Monitor*);
 } Layout;
 
+typedef struct {
+    void (*func)(void); /* NULL if the slot is free */
+    struct timespec due; /* CLOCK_MONOTONIC */
+} Timer;
+
+typedef struct {
+    unsigned long arranges; /* arrangemon() calls */
+    unsigned long syncs; /* XSync() calls, not other requests with a reply */
+    unsigned long wakeups; /* epoll_wait() returns */
+    unsigned long events; /* X events read */
+    unsigned long dispatched; /* X events left after coalesce() */
+    unsigned long maxbatch; /* most X events handled in one batch */
+    unsigned long maps; /* windows managed on MapRequest */
+    unsigned long mapns, maxmapns; /* MapRequest to XMapWindow() latency */
+    unsigned long scanned, scanns; /* windows scan() managed and time taken */
+    unsigned long restacks; /* windows restacked by restackmon() */
+    unsigned long configures, notifies; /* client XConfigureWindow() and synthetic ConfigureNotify */
+    unsigned long deferred; /* occluded clients commitgeometry() skipped */
+    unsigned long views, viewns, maxviewns; /* view() to the end of flushpending() */
+    unsigned long viewreqs; /* X requests sent for those views */
+    unsigned long prearranges; /* hidden tags arranged by prearrange() */
+    unsigned long cachedlayouts; /* arrangemon() calls served by a LayoutCache */
+} Stats;
+
 typedef struct Pertag Pertag;
 struct Monitor {
     char ltsymbol[16];
@@ -111,13 +184,28 @@ struct Monitor {
     int showbar;
     int topbar;
     int showhidden;
-    Client* clients;
+    Client *clients, *tail; /* client list, first and last */
     Client* sel;
-    Client* stack;
+    Client *stack, *stail; /* focus stack, most and least recent */
+    unsigned int nocc[9], nurg[9]; /* clients and urgent clients per tag */
+    unsigned int occ, urg; /* tags with clients and with urgent clients */
+    Client** tiled; /* nexttiled() clients in order, see updatetiled() */
+    TileClient* tilein; /* scratch for the layouts, tiledsize entries */
+    TileRect* tileout;
+    unsigned int ntiled, tiledsize;
+    Client* tiledtail; /* last of tiled */
     Monitor* next;
     Window barwin;
     Pertag* pertag;
     int attachmode;
+    unsigned int dirty;
+    unsigned int stackgen; /* restackmon() calls, see Client */
+    Window frames[9]; /* tag containers, see tagframes */
+    Window framemarks[9]; /* unmapped child of each frame, tiled clients go below */
+    unsigned int framegens[9]; /* stackgen of each frame */
+    int curframe; /* mapped frame, -1 if none */
+    int frameup; /* curframe is stacked above barwin, -1 if unknown */
+    unsigned int staletags; /* tags whose clients or area changed since they were arranged */
 };
 
 typedef struct {
@@ -129,78 +217,133 @@ typedef struct {
     int monitor;
 } Rule;
 
+/* a tiled client as the layout last saw it and where it put it */
+typedef struct {
+    unsigned long id;
+    float cfact;
+    unsigned int hintsgen;
+    int bw;
+    int x, y, w, h, pbw;
+} LayoutSlot;
+
+/* the last arrangement of a tag, reused by arrangemon() while the inputs
+ * stay the same */
+typedef struct {
+    void (*arrange)(Monitor*); /* NULL if empty */
+    float mfact;
+    int nmaster;
+    int wx, wy, ww, wh;
+    char ltsymbol[16];
+    LayoutSlot* slots;
+    unsigned int nslots, size;
+} LayoutCache;
+
 struct Pertag {
     unsigned int curtag, prevtag; /* current and previous tag */
     int nmasters[10]; /* number of windows in master area */
     float mfacts[10]; /* mfacts per tag */
     const Layout* layout[10];
+    LayoutCache cache[10];
+    unsigned int scroll[10]; /* first column in view of the scroll layout */
 };
 
 /* function declarations */
 void applyrules(Client* c);
 int applysizehints(Client* c, int* x, int* y, int* w, int* h, int interact);
+void armtimers(void);
 void arrange(Monitor* m);
 void arrangemon(Monitor* m);
+void arrangetag(Monitor* m, unsigned int t);
 void attach(Client* c);
+void attachbefore(Client* c, Client* next);
 void attachstack(Client* c);
 void buttonpress(XEvent* e);
 void checkotherwm(void);
 void cleanup(void);
 void cleanupmon(Monitor* mon);
 void clientmessage(XEvent* e);
+void coalesce(XEvent* evs, int n);
+int commitclient(Client* c);
+void commitgeometry(void);
 void configure(Client* c);
 void configurenotify(XEvent* e);
 void configurerequest(XEvent* e);
+void counttags(Client* c, int n);
 Monitor* createmon(void);
+void decodetextprop(XTextProperty* name, char* text, unsigned int size);
 void destroynotify(XEvent* e);
 void detach(Client* c);
 void detachstack(Client* c);
 Monitor* dirtomon(int dir);
 void enternotify(XEvent* e);
+Window evwindow(XEvent* ev);
 void expose(XEvent* e);
+void flushpending(void);
 void focus(Client* c);
 void focusin(XEvent* e);
 void focusmon(const Arg* arg);
 void focusstack(const Arg* arg);
 int getrootptr(int* x, int* y);
-long getstate(Window w);
 int gettextprop(Window w, Atom atom, char* text, unsigned int size);
 void grabbuttons(Client* c, int focused);
 void grabkeys(void);
+void hideclient(Client* c);
 void incnmaster(const Arg* arg);
 void keypress(XEvent* e);
 void killclient(Client* c);
 void killselected(const Arg* arg);
 void closewindow(const Arg* arg);
-void manage(Window w, XWindowAttributes* wa);
+int loadlayout(Monitor* m, LayoutCache* lc);
+void manage(Window w, WinProps* p);
 void mappingnotify(XEvent* e);
 void maprequest(XEvent* e);
+void markdirty(Monitor* m, unsigned int flags);
+void markstale(Monitor* m);
+void markoccluded(Monitor* m);
+int mergeevent(XEvent* next, XEvent* prev);
 void motionnotify(XEvent* e);
 void movemouse(const Arg* arg);
+int nextbatch(XEvent* evs, int max);
 Client* nexttiled(Client* c);
+void prearrange(void);
+void printstats(void);
+void placeclient(Client* c, int x, int y, int w, int h, int pbw);
 void propertynotify(XEvent* e);
+unsigned int protocolbit(Atom proto);
 void quit(const Arg* arg);
+void raiseclient(Client* c);
+int raisedcmp(const void* a, const void* b);
+void readsignals(void);
 Monitor* recttomon(int x, int y, int w, int h);
 void resize(Client* c, int x, int y, int w, int h, int interact);
 void resizeclient(Client* c, int x, int y, int w, int h);
 void resizemouse(const Arg* arg);
 void restack(Monitor* m);
+void restackmon(Monitor* m);
 void run(void);
+void runtimers(void);
+void savelayout(Monitor* m, LayoutCache* lc);
 void scan(void);
 int sendevent(Client* c, Atom proto);
 void sendmon(Client* c, Monitor* m);
 void setattach(const Arg* arg);
 void setclientstate(Client* c, long state);
 void setfocus(Client* c);
+void setframe(Client* c, Window frame);
 void setfullscreen(Client* c, int fullscreen);
 void setlayout(const Arg* arg);
 void setcfact(const Arg* arg);
 void setmfact(const Arg* arg);
+void setsizehints(Client* c, XSizeHints* size);
+void settags(Client* c, unsigned int tags);
+void settimeout(void (*func)(void), unsigned int ms);
 void setup(void);
 void seturgent(Client* c, int urg);
-void showhide(Client* c);
-void sigchld(int unused);
+void setwindowtype(Client* c, Atom state, Atom wtype);
+void setwmhints(Client* c, XWMHints* wmh);
+void showhide(Monitor* m);
 void spawn(const Arg* arg);
+void stackframe(Monitor* m);
 void tag(const Arg* arg);
 void tagmon(const Arg* arg);
 void togglefloating(const Arg* arg);
@@ -210,15 +353,21 @@ void toggleview(const Arg* arg);
 void unfocus(Client* c, int setfocus);
 void unmanage(Client* c, int destroyed);
 void unmapnotify(XEvent* e);
+void updateclass(Client* c);
 void updateclientlist(void);
+void updateframes(Monitor* m);
 int updategeom(void);
 void updatenumlockmask(void);
+void updateprotocols(Client* c);
 void updatesizehints(Client* c);
 void updatestatus(void);
+void updatetiled(Monitor* m);
 void updatetitle(Client* c);
 void updatewindowtype(Client* c);
 void updatewmhints(Client* c);
+void updatewmstate(Client* c);
 void view(const Arg* arg);
+void watchfd(int fd);
 Client* wintoclient(Window w);
 Monitor* wintomon(Window w);
 void togglehidden(const Arg* arg);
@@ -226,6 +375,7 @@ void toggleshowhidden(const Arg* arg);
 int xerror(Display* dpy, XErrorEvent* ee);
 int xerrordummy(Display* dpy, XErrorEvent* ee);
 int xerrorstart(Display* dpy, XErrorEvent* ee);
+void xsync(void);
 void zoom(const Arg* arg);
 void movestack(const Arg* arg);
 
@@ -240,10 +390,13 @@ extern int (*xerrorxlib)(Display*, XErrorEvent*);
 extern unsigned int numlockmask;
 extern void (*handler[LASTEvent])(XEvent*);
 extern Atom wmatom[WMLast], netatom[NetLast];
+extern unsigned long enterserial;
 extern int running;
+extern Stats stats;
 extern Cur* cursor[CurLast];
 extern Clr** scheme;
 extern Display* dpy;
+extern xcb_connection_t* xcon;
 extern Drw* drw;
 extern Monitor *mons, *selmon;
 extern Window root, wmcheckwin;
@@ -1,274 +1,184 @@
 #include "layouts.h"
 #include "config.h"
 #include "dwm.h"
+#include "util.h"
 
-void tile(Monitor* m) {
-    unsigned int i, n, h, mw, my, ty;
-    float mfacts = 0, sfacts = 0;
-    Client* c;
+/* The tiling layouts are computed by tiling.c, these feed them m->tiled,
+ * which arrangemon() fills right before, and place the clients. */
 
-    for (n = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), n++) {
-        if (n < m->nmaster)
-            mfacts += c->cfact;
-        else
-            sfacts += c->cfact;
-    }
-    if (n == 0)
-        return;
+static TileParams tileparams(Monitor* m) {
+    TileParams p = {
+        .mw = m->mw, .mh = m->mh,
+        .wx = m->wx, .wy = m->wy, .ww = m->ww, .wh = m->wh,
+        .mfact = m->mfact, .nmaster = m->nmaster,
+        .gappx = gappx, .borderpx = borderpx,
+        .minsize = bh, .sizehints = resizehints
+    };
 
-    if (n > m->nmaster)
-        mw = m->nmaster ? m->ww * m->mfact : 0;
-    else
-        mw = m->ww;
-    for (i = my = ty = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), i++)
-        if (i < m->nmaster) {
-            h = (m->wh - my) * (c->cfact / mfacts);
-            resize(c, m->wx, m->wy + my, mw - (2 * c->bw), h - (2 * c->bw), 0);
-            my += HEIGHT(c);
-            mfacts -= c->cfact;
-        } else {
-            h = (m->wh - ty) * (c->cfact / sfacts);
-            resize(c, m->wx + mw, m->wy + ty, m->ww - mw - (2 * c->bw), h - (2 * c->bw), 0);
-            ty += HEIGHT(c);
-            sfacts -= c->cfact;
-        }
+    return p;
 }
 
-void centeredmaster(Monitor* m) {
-    unsigned int i, n, h, mw, mx, my, oty, ety, tw;
-    float mfacts = 0, lfacts = 0, rfacts = 0;
+/* copies m->tiled[lo..hi) into m->tilein */
+static void tileclients(Monitor* m, unsigned int lo, unsigned int hi) {
+    TileClient* t;
     Client* c;
-
-    /* count number of clients in the selected monitor */
-    for (n = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), n++) {
-        if (n < m->nmaster)
-            mfacts += c->cfact;
-        else if ((n - m->nmaster) % 2)
-            lfacts += c->cfact;
-        else
-            rfacts += c->cfact;
-    }
-    if (n == 0)
-        return;
-    if (n == 1) {
-        c = nexttiled(m->clients);
-        resize(c, m->wx, m->wy, m->ww - 2 * c->bw, m->wh - 2 * c->bw, 0);
-        return;
+    unsigned int i;
+
+    for (i = lo; i < hi; i++) {
+        c        = m->tiled[i];
+        t        = &m->tilein[i];
+        t->cfact = c->cfact;
+        t->bw    = c->bw;
+        t->basew = c->basew;
+        t->baseh = c->baseh;
+        t->incw  = c->incw;
+        t->inch  = c->inch;
+        t->maxw  = c->maxw;
+        t->maxh  = c->maxh;
+        t->minw  = c->minw;
+        t->minh  = c->minh;
+        t->mina  = c->mina;
+        t->maxa  = c->maxa;
     }
+}
 
-    /* initialize areas */
-    mw = m->ww;
-    mx = 0;
-    my = 0;
-    tw = mw;
-
-    if (n > m->nmaster) {
-        /* go mfact box in the center if more than nmaster clients */
-        mw = m->nmaster ? m->ww * m->mfact : 0;
-        tw = m->ww - mw;
+static void arrangetiled(Monitor* m, TileFunc f) {
+    TileParams p = tileparams(m);
+    TileRect* r;
+    unsigned int i;
 
-        if (n - m->nmaster > 1) {
-            /* only one client */
-            mx = (m->ww - mw) / 2;
-            tw = (m->ww - mw) / 2;
-        }
+    tileclients(m, 0, m->ntiled);
+    f(&p, m->tilein, m->tileout, m->ntiled);
+    for (i = 0; i < m->ntiled; i++) {
+        r = &m->tileout[i];
+        placeclient(m->tiled[i], r->x, r->y, r->w, r->h, r->bw);
     }
-
-    oty = 0;
-    ety = 0;
-    for (i = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), i++)
-        if (i < m->nmaster) {
-            /* nmaster clients are stacked vertically, in the center
-		 * of the screen */
-            h = (m->wh - my) * (c->cfact / mfacts);
-            resize(c, m->wx + mx, m->wy + my, mw - 2 * c->bw,
-                h - 2 * c->bw, 0);
-            if (my + HEIGHT(c) < m->mh)
-                my += HEIGHT(c);
-            mfacts -= c->cfact;
-        } else {
-            /* stack clients are stacked vertically */
-            if ((i - m->nmaster) % 2) {
-                h = (m->wh - ety) * (c->cfact / lfacts);
-                if (m->nmaster == 0)
-                    resize(c, m->wx, m->wy + ety, tw - 2 * c->bw,
-                        h - 2 * c->bw, 0);
-                else
-                    resize(c, m->wx, m->wy + ety, tw - 2 * c->bw,
-                        h - 2 * c->bw, 0);
-                if (ety + HEIGHT(c) < m->mh)
-                    ety += HEIGHT(c);
-                lfacts -= c->cfact;
-            } else {
-                h = (m->wh - oty) * (c->cfact / rfacts);
-                resize(c, m->wx + mx + mw, m->wy + oty,
-                    tw - 2 * c->bw, h - 2 * c->bw, 0);
-                if (oty + HEIGHT(c) < m->mh)
-                    oty += HEIGHT(c);
-                rfacts -= c->cfact;
-            }
-        }
 }
 
-void centeredfloatingmaster(Monitor* m) {
-    unsigned int i, n, w, mh, mw, mx, mxo, my, myo, tx;
-    float mfacts = 0, sfacts = 0;
-    Client* c;
-
-    /* count number of clients in the selected monitor */
-    for (n = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), n++) {
-        if (n < m->nmaster)
-            mfacts += c->cfact;
-        else
-            sfacts += c->cfact;
-    }
-    if (n == 0)
-        return;
-    if (n == 1) {
-        c = nexttiled(m->clients);
-        resize(c, m->wx, m->wy, m->ww - 2 * c->bw, m->wh - 2 * c->bw, 0);
-        return;
-    }
+void tile(Monitor* m) {
+    arrangetiled(m, tilerects);
+}
 
-    /* initialize nmaster area */
-    if (n > m->nmaster) {
-        /* go mfact box in the center if more than nmaster clients */
-        if (m->ww > m->wh) {
-            mw = m->nmaster ? m->ww * m->mfact : 0;
-            mh = m->nmaster ? m->wh * 0.9 : 0;
-        } else {
-            mh = m->nmaster ? m->wh * m->mfact : 0;
-            mw = m->nmaster ? m->ww * 0.9 : 0;
-        }
-        mx = mxo = (m->ww - mw) / 2;
-        my = myo = (m->wh - mh) / 2;
-    } else {
-        /* go fullscreen if all clients are in the master area */
-        mh = m->wh;
-        mw = m->ww;
-        mx = mxo = 0;
-        my = myo = 0;
-    }
+void centeredmaster(Monitor* m) {
+    arrangetiled(m, centeredmasterrects);
+}
 
-    for (i = tx = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), i++)
-        if (i < m->nmaster) {
-            /* nmaster clients are stacked horizontally, in the center
-		 * of the screen */
-            w = (mw + mxo - mx) * (c->cfact / mfacts);
-            resize(c, m->wx + mx, m->wy + my, w - 2 * c->bw,
-                mh - 2 * c->bw, 0);
-            if (mx + WIDTH(c) < m->mw)
-                mx += WIDTH(c);
-            mfacts -= c->cfact;
-        } else {
-            /* stack clients are stacked horizontally */
-            w = (m->ww - tx) * (c->cfact / sfacts);
-            resize(c, m->wx + tx, m->wy, w - 2 * c->bw,
-                m->wh - 2 * c->bw, 0);
-            if (tx + WIDTH(c) < m->mw)
-                tx += WIDTH(c);
-            sfacts -= c->cfact;
-        }
+void centeredfloatingmaster(Monitor* m) {
+    arrangetiled(m, centeredfloatingmasterrects);
 }
 
 void dwindle(Monitor* mon) {
-    unsigned int i, n, nx, ny, nw, nh, ow, oh, my = 0;
-    float mfacts = 0;
-    Client* c;
-
-    for (n = 0, c = nexttiled(mon->clients); c; c = nexttiled(c->next), n++)
-        if (n < mon->nmaster)
-            mfacts += c->cfact;
-    if (n == 0)
-        return;
-
-    nx = mon->wx;
-    ny = mon->wy;
-    nw = mon->ww;
-    nh = mon->wh;
-
-    for (i = 0, c = nexttiled(mon->clients); c; c = nexttiled(c->next)) {
-        if (n > 1 && mon->nmaster > 0 && i == mon->nmaster) {
-            // reset values for first client in stack
-            nw = mon->ww * (1 - mon->mfact);
-            nh = mon->wh;
-            ny = mon->wy;
-        }
-        ow = nw;
-        oh = nh;
-        if (n > 1 && i < mon->nmaster) {
-            // master
-            // TODO kaputt für mehrere master
-            nw = mon->ww * mon->mfact;
-            nh = (mon->wh - my) * (c->cfact / mfacts);
-            nx = mon->wx;
-            ny = mon->wy + my;
-            my += nh;
-            mfacts -= c->cfact;
-        } else if (n > 1 && i < n - 1) {
-            // stack
-            if ((i - mon->nmaster) % 2)
-                nw *= (c->cfact / 2);
-            else
-                nh *= (c->cfact / 2);
-        }
-        resize(c, nx, ny, nw - 2 * c->bw, nh - 2 * c->bw, False);
-        if ((i - mon->nmaster) % 2) {
-            nx += nw;
-            nw = ow - nw;
-        } else {
-            ny += nh;
-            nh = oh - nh;
-        }
-        i++;
-    }
+    arrangetiled(mon, dwindlerects);
 }
 
 void layout_float(Monitor* mon) {
     Client* c;
-    unsigned int curtag = selmon->pertag->curtag;
+    unsigned int i, curtag = selmon->pertag->curtag;
 
-    for (c = nexttiled(mon->clients); c; c = nexttiled(c->next)) {
-        resize(c, c->fx[curtag], c->fy[curtag], c->fw[curtag], c->fh[curtag], 1);
+    for (i = 0; i < mon->ntiled; i++) {
+        c = mon->tiled[i];
+        resize(c, c->cold->fx[curtag], c->cold->fy[curtag], c->cold->fw[curtag], c->cold->fh[curtag], 1);
     }
 }
 
 void monocle(Monitor* m) {
-    unsigned int n = 0;
-    Client* c;
+    unsigned int n = m->ntiled;
 
-    for (c = nexttiled(m->clients); c; c = nexttiled(c->next))
-        n++;
     if (n > 0) /* override layout symbol */
         snprintf(m->ltsymbol, sizeof m->ltsymbol, "[%d]", n);
-    for (c = nexttiled(m->clients); c; c = nexttiled(c->next))
-        resize(c, m->wx, m->wy, m->ww - 2 * c->bw, m->wh - 2 * c->bw, 0);
+    arrangetiled(m, monoclerects);
 }
 
 void deck(Monitor* m) {
-    unsigned int i, n, h, mw, my;
-    float mfacts = 0;
-    Client* c;
+    unsigned int n = m->ntiled;
+
+    if (n > 0 && n > m->nmaster)
+        snprintf(m->ltsymbol, sizeof m->ltsymbol, "[%d]", n - m->nmaster);
+    arrangetiled(m, deckrects);
+}
 
-    for (n = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), n++) {
-        if (n < m->nmaster)
-            mfacts += c->cfact;
+static void park(Client* c) {
+    placeclient(c, -2 * WIDTH(c), c->y, c->w, c->h, c->pbw);
+}
+
+/* Moves the first column in view of the scroll layout so that the selected
+ * client is in view, and returns it. */
+static unsigned int scrollfirst(Monitor* m, unsigned int cols) {
+    unsigned int* first = &m->pertag->scroll[m->pertag->curtag];
+    unsigned int sel, n = m->ntiled;
+    Client* c = m->sel;
+
+    if (c && c->tiledpos < n && m->tiled[c->tiledpos] == c) {
+        sel = c->tiledpos;
+        if (sel < *first)
+            *first = sel;
+        else if (sel >= *first + cols)
+            *first = sel - cols + 1;
+        snprintf(m->ltsymbol, sizeof m->ltsymbol, "[%hu/%hu]", (unsigned short)(sel + 1), (unsigned short)n);
     }
-    if (n == 0)
+    *first = MIN(*first, n > cols ? n - cols : 0);
+    return *first;
+}
+
+/* Arranges the columns in view, from first on, and the one on either side
+ * of them, which get their size but stay off-screen. Returns the range of
+ * m->tiled it placed in lo and hi. */
+static void placecolumns(Monitor* m, unsigned int first, unsigned int cols,
+    unsigned int* lo, unsigned int* hi) {
+    TileParams p = tileparams(m);
+    unsigned int i;
+    TileRect* r;
+
+    *lo = first ? first - 1 : 0;
+    *hi = MIN(m->ntiled, first + cols + 1);
+    /* the strip starts at column lo, so that column first is at wx; with
+     * two or more clients there are two or more columns in lo..hi, which
+     * keeps the gaps like they are for the whole strip */
+    p.wx -= (first - *lo) * (p.ww / cols);
+    tileclients(m, *lo, *hi);
+    scrollrects(&p, m->tilein + *lo, m->tileout + *lo, *hi - *lo);
+    for (i = *lo; i < *hi; i++) {
+        r = &m->tileout[i];
+        if (i >= first && i < first + cols)
+            placeclient(m->tiled[i], r->x, r->y, r->w, r->h, r->bw);
+        else
+            placeclient(m->tiled[i], -2 * (r->w + 2 * r->bw + gappx), r->y, r->w, r->h, r->bw);
+    }
+}
+
+/* Columns scrolling sideways with the selected client. Only the columns in
+ * view and the one on either side of them are arranged. Every other client
+ * is parked off-screen as it is, so nothing is sent for it until it scrolls
+ * near the view. */
+void scroll(Monitor* m) {
+    TileParams p = tileparams(m);
+    unsigned int i, cols, lo, hi;
+
+    if (m->ntiled == 0)
         return;
+    cols = scrollcolumns(&p);
+    placecolumns(m, scrollfirst(m, cols), cols, &lo, &hi);
+    /* after a change of the clients any of them may be on screen */
+    for (i = 0; i < m->ntiled; i++)
+        if (i < lo || i >= hi)
+            park(m->tiled[i]);
+}
 
-    if (n > m->nmaster) {
-        mw = m->nmaster ? m->ww * m->mfact : 0;
-        snprintf(m->ltsymbol, sizeof m->ltsymbol, "[%d]", n - m->nmaster);
-    } else
-        mw = m->ww;
-    for (i = my = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), i++)
-        if (i < m->nmaster) {
-            h = (m->wh - my) * (c->cfact / mfacts);
-            resize(c, m->wx, m->wy + my, mw - (2 * c->bw), h - (2 * c->bw), False);
-            if (my + HEIGHT(c) < m->wh)
-                my += HEIGHT(c);
-            mfacts -= c->cfact;
-        } else
-            resize(c, m->wx + mw, m->wy, m->ww - mw - (2 * c->bw), m->wh - (2 * c->bw), False);
+/* Brings the selected client into view after a focus change, which leaves
+ * m->tiled as the last arrangemon() made it. Only the columns entering and
+ * leaving the view are touched. */
+void scrollview(Monitor* m) {
+    TileParams p = tileparams(m);
+    unsigned int i, cols, oldlo, oldhi, lo, hi;
+
+    if (m->ntiled == 0)
+        return;
+    cols  = scrollcolumns(&p);
+    i     = m->pertag->scroll[m->pertag->curtag];
+    oldlo = i ? i - 1 : 0;
+    oldhi = MIN(m->ntiled, i + cols + 1);
+    placecolumns(m, scrollfirst(m, cols), cols, &lo, &hi);
+    for (i = oldlo; i < oldhi; i++)
+        if (i < lo || i >= hi)
+            park(m->tiled[i]);
 }
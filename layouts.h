@@ -10,5 +10,7 @@ void dwindle(Monitor* mon);
 void layout_float(Monitor* mon);
 void monocle(Monitor* m);
 void deck(Monitor* m);
+void scroll(Monitor* m);
+void scrollview(Monitor* m);
 
 #endif
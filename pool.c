@@ -0,0 +1,60 @@
+/* Slab allocator for objects of one size.
+ *
+ * Objects are handed out from slabs of perslab objects each, so objects
+ * allocated together lie next to each other in memory. Freed objects go onto
+ * a free list which is consumed before a new slab is allocated. Slabs are only
+ * released by pool_destroy(). Objects are zeroed like ecalloc() does. */
+
+#include <string.h>
+
+#include "pool.h"
+#include "util.h"
+
+struct PoolSlab {
+    PoolSlab* next;
+    max_align_t objs[]; /* perslab objects of size bytes */
+};
+
+static size_t stride(Pool* p) {
+    /* keep every object aligned like malloc() would */
+    return (p->size + sizeof(max_align_t) - 1) / sizeof(max_align_t) * sizeof(max_align_t);
+}
+
+void* pool_alloc(Pool* p) {
+    PoolSlab* s;
+    char* obj;
+    size_t i, n = stride(p);
+
+    if (!p->free) {
+        s        = ecalloc(1, sizeof(PoolSlab) + p->perslab * n);
+        s->next  = p->slabs;
+        p->slabs = s;
+        /* thread the new objects in address order */
+        for (i = p->perslab; i--;) {
+            obj          = (char*)s->objs + i * n;
+            *(void**)obj = p->free;
+            p->free      = obj;
+        }
+    }
+    obj     = p->free;
+    p->free = *(void**)obj;
+    memset(obj, 0, p->size);
+    return obj;
+}
+
+void pool_free(Pool* p, void* obj) {
+    if (!obj)
+        return;
+    *(void**)obj = p->free;
+    p->free      = obj;
+}
+
+void pool_destroy(Pool* p) {
+    PoolSlab* s;
+
+    while ((s = p->slabs)) {
+        p->slabs = s->next;
+        free(s);
+    }
+    p->free = NULL;
+}
@@ -0,0 +1,22 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+
+typedef struct PoolSlab PoolSlab;
+
+/* fixed size objects carved out of slabs, freed objects are reused first */
+typedef struct {
+    size_t size; /* object size, at least sizeof(void*) */
+    size_t perslab; /* objects per slab */
+    PoolSlab* slabs;
+    void* free; /* free list threaded through the free objects */
+} Pool;
+
+#define POOL(type, n) { sizeof(type) > sizeof(void*) ? sizeof(type) : sizeof(void*), (n), NULL, NULL }
+
+void* pool_alloc(Pool* p);
+void pool_free(Pool* p, void* obj);
+void pool_destroy(Pool* p);
+
+#endif
@@ -0,0 +1,152 @@
+/* Reading the state of a new window without a round-trip per property.
+ *
+ * Xlib's property getters wait for each reply before the next request is
+ * sent. requestprops() sends all requests manage() depends on through the
+ * XCB connection underlying dpy, readprops() collects the replies, so the
+ * whole set costs a single round-trip. Many windows can be requested before
+ * the first one is read. */
+
+#include "props.h"
+#include "dwm.h"
+#include "util.h"
+
+#define ALLOFIT (UINT32_MAX / 4) /* property length in 32 bit units */
+
+static void* propvalue(xcb_get_property_reply_t* r, xcb_atom_t type, uint8_t format, int minlen) {
+    if (!r || r->type != type || r->format != format || xcb_get_property_value_length(r) < minlen * (format / 8))
+        return NULL;
+    return xcb_get_property_value(r);
+}
+
+static xcb_get_property_cookie_t getprop(Window w, Atom prop, Atom type, uint32_t len) {
+    return xcb_get_property(xcon, 0, w, prop, type, 0, len);
+}
+
+static int readtext(xcb_get_property_reply_t* r, char* text, unsigned int size) {
+    XTextProperty name;
+    int len;
+
+    if (!r || r->type == None || !(len = xcb_get_property_value_length(r)))
+        return 0;
+    /* Xlib guarantees a terminating NUL for the XA_STRING case, XCB does not */
+    name.value = ecalloc(len + 1, 1);
+    memcpy(name.value, xcb_get_property_value(r), len);
+    name.encoding = r->type;
+    name.format   = r->format;
+    name.nitems   = r->value_len;
+    decodetextprop(&name, text, size);
+    free(name.value);
+    return 1;
+}
+
+static void readsizehints(xcb_get_property_reply_t* r, XSizeHints* size) {
+    uint32_t* v;
+
+    /* same rules as XGetWMNormalHints(), pre ICCCM hints lack base size and gravity */
+    memset(size, 0, sizeof(XSizeHints));
+    if (!(v = propvalue(r, XA_WM_SIZE_HINTS, 32, 15))) {
+        size->flags = PSize;
+        return;
+    }
+    size->flags = v[0] & (USPosition | USSize | PAllHints);
+    size->x = v[1], size->y = v[2], size->width = v[3], size->height = v[4];
+    size->min_width = v[5], size->min_height = v[6];
+    size->max_width = v[7], size->max_height = v[8];
+    size->width_inc = v[9], size->height_inc = v[10];
+    size->min_aspect.x = v[11], size->min_aspect.y = v[12];
+    size->max_aspect.x = v[13], size->max_aspect.y = v[14];
+    if (xcb_get_property_value_length(r) >= 18 * 4) {
+        size->flags |= v[0] & (PBaseSize | PWinGravity);
+        size->base_width  = v[15];
+        size->base_height = v[16];
+        size->win_gravity = v[17];
+    }
+}
+
+static int readwmhints(xcb_get_property_reply_t* r, XWMHints* wmh) {
+    uint32_t* v;
+
+    /* same rules as XGetWMHints(), window_group may be missing */
+    memset(wmh, 0, sizeof(XWMHints));
+    if (!(v = propvalue(r, XA_WM_HINTS, 32, 8)))
+        return 0;
+    wmh->flags         = v[0];
+    wmh->input         = v[1];
+    wmh->initial_state = v[2];
+    wmh->icon_pixmap   = v[3];
+    wmh->icon_window   = v[4];
+    wmh->icon_x        = v[5];
+    wmh->icon_y        = v[6];
+    wmh->icon_mask     = v[7];
+    if (xcb_get_property_value_length(r) >= 9 * 4)
+        wmh->window_group = v[8];
+    else
+        wmh->flags &= ~WindowGroupHint;
+    return 1;
+}
+
+void requestprops(Window w, PropRequest* r) {
+    r->attributes = xcb_get_window_attributes(xcon, w);
+    r->geometry   = xcb_get_geometry(xcon, w);
+    r->props[PropNetWMName]       = getprop(w, netatom[NetWMName], AnyPropertyType, ALLOFIT);
+    r->props[PropWMName]          = getprop(w, XA_WM_NAME, AnyPropertyType, ALLOFIT);
+    r->props[PropClass]           = getprop(w, XA_WM_CLASS, XA_STRING, ALLOFIT);
+    r->props[PropTransientFor]    = getprop(w, XA_WM_TRANSIENT_FOR, XA_WINDOW, 1);
+    r->props[PropNetWMState]      = getprop(w, netatom[NetWMState], XA_ATOM, 1);
+    r->props[PropNetWMWindowType] = getprop(w, netatom[NetWMWindowType], XA_ATOM, 1);
+    r->props[PropNormalHints]     = getprop(w, XA_WM_NORMAL_HINTS, XA_WM_SIZE_HINTS, 18);
+    r->props[PropHints]           = getprop(w, XA_WM_HINTS, XA_WM_HINTS, 9);
+    r->props[PropWMState]         = getprop(w, wmatom[WMState], wmatom[WMState], 2);
+    r->props[PropProtocols]       = getprop(w, wmatom[WMProtocols], XA_ATOM, ALLOFIT);
+}
+
+int readprops(PropRequest* r, WinProps* p) {
+    xcb_get_window_attributes_reply_t* attr;
+    xcb_get_geometry_reply_t* geom;
+    xcb_get_property_reply_t* props[PropLast];
+    uint32_t* v;
+    char *s, *e;
+    int i, len, ok;
+
+    attr = xcb_get_window_attributes_reply(xcon, r->attributes, NULL);
+    geom = xcb_get_geometry_reply(xcon, r->geometry, NULL);
+    /* collect every reply, even if the window is gone, not to leak them */
+    for (i = 0; i < PropLast; i++)
+        props[i] = xcb_get_property_reply(xcon, r->props[i], NULL);
+    memset(p, 0, sizeof(WinProps));
+    if ((ok = attr && geom)) {
+        p->wa.x                 = geom->x;
+        p->wa.y                 = geom->y;
+        p->wa.width             = geom->width;
+        p->wa.height            = geom->height;
+        p->wa.border_width      = geom->border_width;
+        p->wa.map_state         = attr->map_state;
+        p->wa.override_redirect = attr->override_redirect;
+
+        if (!readtext(props[PropNetWMName], p->name, sizeof p->name))
+            readtext(props[PropWMName], p->name, sizeof p->name);
+        if (p->name[0] == '\0') /* hack to mark broken clients */
+            strcpy(p->name, broken);
+        /* WM_CLASS is "instance\0class\0" */
+        if ((s = propvalue(props[PropClass], XA_STRING, 8, 1))) {
+            len = xcb_get_property_value_length(props[PropClass]);
+            snprintf(p->instance, sizeof p->instance, "%.*s", len, s);
+            if ((e = memchr(s, '\0', len)))
+                snprintf(p->class, sizeof p->class, "%.*s", (int)(s + len - e - 1), e + 1);
+        }
+        p->trans = (v = propvalue(props[PropTransientFor], XA_WINDOW, 32, 1)) ? v[0] : None;
+        p->state = (v = propvalue(props[PropNetWMState], XA_ATOM, 32, 1)) ? v[0] : None;
+        p->wtype = (v = propvalue(props[PropNetWMWindowType], XA_ATOM, 32, 1)) ? v[0] : None;
+        readsizehints(props[PropNormalHints], &p->size);
+        p->haswmh  = readwmhints(props[PropHints], &p->wmh);
+        p->wmstate = (v = propvalue(props[PropWMState], wmatom[WMState], 32, 1)) ? (long)v[0] : -1;
+        if ((v = propvalue(props[PropProtocols], XA_ATOM, 32, 1)))
+            for (len = xcb_get_property_value_length(props[PropProtocols]) / 4; len--;)
+                p->protocols |= protocolbit(v[len]);
+    }
+    free(attr);
+    free(geom);
+    for (i = 0; i < PropLast; i++)
+        free(props[i]);
+    return ok;
+}
@@ -0,0 +1,35 @@
+#ifndef PROPS_H
+#define PROPS_H
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <xcb/xcb.h>
+
+enum { PropNetWMName, PropWMName, PropClass, PropTransientFor, PropNetWMState,
+    PropNetWMWindowType, PropNormalHints, PropHints, PropWMState, PropProtocols, PropLast };
+
+/* requests issued by requestprops(), their replies are read by readprops() */
+typedef struct {
+    xcb_get_window_attributes_cookie_t attributes;
+    xcb_get_geometry_cookie_t geometry;
+    xcb_get_property_cookie_t props[PropLast];
+} PropRequest;
+
+/* what manage() needs to know about a window */
+typedef struct {
+    XWindowAttributes wa; /* geometry, map_state and override_redirect only */
+    char name[256]; /* _NET_WM_NAME, WM_NAME or broken */
+    char instance[256], class[256]; /* WM_CLASS, empty if unset */
+    Window trans; /* WM_TRANSIENT_FOR or None */
+    Atom state, wtype; /* first atom of _NET_WM_STATE and _NET_WM_WINDOW_TYPE */
+    XSizeHints size; /* flags are PSize without WM_NORMAL_HINTS */
+    XWMHints wmh;
+    int haswmh;
+    long wmstate; /* WM_STATE or -1 */
+    unsigned int protocols; /* see Client */
+} WinProps;
+
+void requestprops(Window w, PropRequest* r);
+int readprops(PropRequest* r, WinProps* p);
+
+#endif
@@ -0,0 +1,340 @@
+#include "tiling.h"
+#include "util.h"
+
+/* outer size of a placed client and its gap, like WIDTH() and HEIGHT() in dwm */
+#define RWIDTH(P, R, C)  ((R)->w + 2 * (C)->bw + (P)->gappx)
+#define RHEIGHT(P, R, C) ((R)->h + 2 * (C)->bw + (P)->gappx)
+
+/* What resize() does to a tiled client, but for keeping it inside the
+ * window area: the size hints as applysizehints() applies them, then the
+ * gaps of resizeclient(). A lone client or one in monocle (nogaps) loses
+ * its border and gap. */
+static void fit(const TileParams* p, const TileClient* c, TileRect* r, unsigned int n,
+    int x, int y, int w, int h, int nogaps) {
+    int baseismin;
+
+    if (h < p->minsize)
+        h = p->minsize;
+    if (w < p->minsize)
+        w = p->minsize;
+    if (p->sizehints) {
+        /* see last two sentences in ICCCM 4.1.2.3 */
+        baseismin = c->basew == c->minw && c->baseh == c->minh;
+        if (!baseismin) { /* temporarily remove base dimensions */
+            w -= c->basew;
+            h -= c->baseh;
+        }
+        /* adjust for aspect limits */
+        if (c->mina > 0 && c->maxa > 0) {
+            if (c->maxa < (float)w / h)
+                w = h * c->maxa + 0.5;
+            else if (c->mina < (float)h / w)
+                h = w * c->mina + 0.5;
+        }
+        if (baseismin) { /* increment calculation requires this */
+            w -= c->basew;
+            h -= c->baseh;
+        }
+        /* adjust for increment value */
+        if (c->incw)
+            w -= w % c->incw;
+        if (c->inch)
+            h -= h % c->inch;
+        /* restore base dimensions */
+        w = MAX(w + c->basew, c->minw);
+        h = MAX(h + c->baseh, c->minh);
+        if (c->maxw)
+            w = MIN(w, c->maxw);
+        if (c->maxh)
+            h = MIN(h, c->maxh);
+    }
+    if (nogaps || n <= 1) {
+        r->x  = x;
+        r->y  = y;
+        r->w  = w + 2 * p->borderpx;
+        r->h  = h + 2 * p->borderpx;
+        r->bw = 0;
+    } else {
+        r->x  = x + p->gappx;
+        r->y  = y + p->gappx;
+        r->w  = w - 2 * p->gappx;
+        r->h  = h - 2 * p->gappx;
+        r->bw = c->bw;
+    }
+}
+
+/* fit(), after moving the client into the window area like resize() */
+static void place(const TileParams* p, const TileClient* c, TileRect* r, unsigned int n,
+    int x, int y, int w, int h, int nogaps) {
+    w = MAX(1, w);
+    h = MAX(1, h);
+    if (x >= p->wx + p->ww)
+        x = p->wx + p->ww - (w + 2 * c->bw);
+    if (y >= p->wy + p->wh)
+        y = p->wy + p->wh - (h + 2 * c->bw);
+    if (x + w + 2 * c->bw <= p->wx)
+        x = p->wx;
+    if (y + h + 2 * c->bw <= p->wy)
+        y = p->wy;
+    fit(p, c, r, n, x, y, w, h, nogaps);
+}
+
+void tilerects(const TileParams* p, const TileClient* c, TileRect* r, unsigned int n) {
+    unsigned int i, h, mw, my, ty;
+    float mfacts = 0, sfacts = 0;
+
+    if (n == 0)
+        return;
+    for (i = 0; i < n; i++) {
+        if (i < p->nmaster)
+            mfacts += c[i].cfact;
+        else
+            sfacts += c[i].cfact;
+    }
+
+    if (n > p->nmaster)
+        mw = p->nmaster ? p->ww * p->mfact : 0;
+    else
+        mw = p->ww;
+    for (i = my = ty = 0; i < n; i++) {
+        if (i < p->nmaster) {
+            h = (p->wh - my) * (c[i].cfact / mfacts);
+            place(p, &c[i], &r[i], n, p->wx, p->wy + my, mw - (2 * c[i].bw), h - (2 * c[i].bw), 0);
+            my += RHEIGHT(p, &r[i], &c[i]);
+            mfacts -= c[i].cfact;
+        } else {
+            h = (p->wh - ty) * (c[i].cfact / sfacts);
+            place(p, &c[i], &r[i], n, p->wx + mw, p->wy + ty, p->ww - mw - (2 * c[i].bw), h - (2 * c[i].bw), 0);
+            ty += RHEIGHT(p, &r[i], &c[i]);
+            sfacts -= c[i].cfact;
+        }
+    }
+}
+
+void centeredmasterrects(const TileParams* p, const TileClient* c, TileRect* r, unsigned int n) {
+    unsigned int i, h, mw, mx, my, oty, ety, tw;
+    float mfacts = 0, lfacts = 0, rfacts = 0;
+
+    if (n == 0)
+        return;
+    for (i = 0; i < n; i++) {
+        if (i < p->nmaster)
+            mfacts += c[i].cfact;
+        else if ((i - p->nmaster) % 2)
+            lfacts += c[i].cfact;
+        else
+            rfacts += c[i].cfact;
+    }
+    if (n == 1) {
+        place(p, &c[0], &r[0], n, p->wx, p->wy, p->ww - 2 * c[0].bw, p->wh - 2 * c[0].bw, 0);
+        return;
+    }
+
+    /* initialize areas */
+    mw = p->ww;
+    mx = 0;
+    my = 0;
+    tw = mw;
+
+    if (n > p->nmaster) {
+        /* go mfact box in the center if more than nmaster clients */
+        mw = p->nmaster ? p->ww * p->mfact : 0;
+        tw = p->ww - mw;
+
+        if (n - p->nmaster > 1) {
+            /* only one client */
+            mx = (p->ww - mw) / 2;
+            tw = (p->ww - mw) / 2;
+        }
+    }
+
+    oty = 0;
+    ety = 0;
+    for (i = 0; i < n; i++) {
+        if (i < p->nmaster) {
+            /* nmaster clients are stacked vertically, in the center
+             * of the screen */
+            h = (p->wh - my) * (c[i].cfact / mfacts);
+            place(p, &c[i], &r[i], n, p->wx + mx, p->wy + my, mw - 2 * c[i].bw,
+                h - 2 * c[i].bw, 0);
+            if (my + RHEIGHT(p, &r[i], &c[i]) < p->mh)
+                my += RHEIGHT(p, &r[i], &c[i]);
+            mfacts -= c[i].cfact;
+        } else {
+            /* stack clients are stacked vertically */
+            if ((i - p->nmaster) % 2) {
+                h = (p->wh - ety) * (c[i].cfact / lfacts);
+                place(p, &c[i], &r[i], n, p->wx, p->wy + ety, tw - 2 * c[i].bw,
+                    h - 2 * c[i].bw, 0);
+                if (ety + RHEIGHT(p, &r[i], &c[i]) < p->mh)
+                    ety += RHEIGHT(p, &r[i], &c[i]);
+                lfacts -= c[i].cfact;
+            } else {
+                h = (p->wh - oty) * (c[i].cfact / rfacts);
+                place(p, &c[i], &r[i], n, p->wx + mx + mw, p->wy + oty,
+                    tw - 2 * c[i].bw, h - 2 * c[i].bw, 0);
+                if (oty + RHEIGHT(p, &r[i], &c[i]) < p->mh)
+                    oty += RHEIGHT(p, &r[i], &c[i]);
+                rfacts -= c[i].cfact;
+            }
+        }
+    }
+}
+
+void centeredfloatingmasterrects(const TileParams* p, const TileClient* c, TileRect* r, unsigned int n) {
+    unsigned int i, w, mh, mw, mx, mxo, my, myo, tx;
+    float mfacts = 0, sfacts = 0;
+
+    if (n == 0)
+        return;
+    for (i = 0; i < n; i++) {
+        if (i < p->nmaster)
+            mfacts += c[i].cfact;
+        else
+            sfacts += c[i].cfact;
+    }
+    if (n == 1) {
+        place(p, &c[0], &r[0], n, p->wx, p->wy, p->ww - 2 * c[0].bw, p->wh - 2 * c[0].bw, 0);
+        return;
+    }
+
+    /* initialize nmaster area */
+    if (n > p->nmaster) {
+        /* go mfact box in the center if more than nmaster clients */
+        if (p->ww > p->wh) {
+            mw = p->nmaster ? p->ww * p->mfact : 0;
+            mh = p->nmaster ? p->wh * 0.9 : 0;
+        } else {
+            mh = p->nmaster ? p->wh * p->mfact : 0;
+            mw = p->nmaster ? p->ww * 0.9 : 0;
+        }
+        mx = mxo = (p->ww - mw) / 2;
+        my = myo = (p->wh - mh) / 2;
+    } else {
+        /* go fullscreen if all clients are in the master area */
+        mh = p->wh;
+        mw = p->ww;
+        mx = mxo = 0;
+        my = myo = 0;
+    }
+
+    for (i = tx = 0; i < n; i++) {
+        if (i < p->nmaster) {
+            /* nmaster clients are stacked horizontally, in the center
+             * of the screen */
+            w = (mw + mxo - mx) * (c[i].cfact / mfacts);
+            place(p, &c[i], &r[i], n, p->wx + mx, p->wy + my, w - 2 * c[i].bw,
+                mh - 2 * c[i].bw, 0);
+            if (mx + RWIDTH(p, &r[i], &c[i]) < p->mw)
+                mx += RWIDTH(p, &r[i], &c[i]);
+            mfacts -= c[i].cfact;
+        } else {
+            /* stack clients are stacked horizontally */
+            w = (p->ww - tx) * (c[i].cfact / sfacts);
+            place(p, &c[i], &r[i], n, p->wx + tx, p->wy, w - 2 * c[i].bw,
+                p->wh - 2 * c[i].bw, 0);
+            if (tx + RWIDTH(p, &r[i], &c[i]) < p->mw)
+                tx += RWIDTH(p, &r[i], &c[i]);
+            sfacts -= c[i].cfact;
+        }
+    }
+}
+
+void dwindlerects(const TileParams* p, const TileClient* c, TileRect* r, unsigned int n) {
+    unsigned int i, nx, ny, nw, nh, ow, oh, my = 0;
+    float mfacts = 0;
+
+    if (n == 0)
+        return;
+    for (i = 0; i < n && i < p->nmaster; i++)
+        mfacts += c[i].cfact;
+
+    nx = p->wx;
+    ny = p->wy;
+    nw = p->ww;
+    nh = p->wh;
+
+    for (i = 0; i < n; i++) {
+        if (n > 1 && p->nmaster > 0 && i == p->nmaster) {
+            // reset values for first client in stack
+            nw = p->ww * (1 - p->mfact);
+            nh = p->wh;
+            ny = p->wy;
+        }
+        ow = nw;
+        oh = nh;
+        if (n > 1 && i < p->nmaster) {
+            // master
+            // TODO kaputt für mehrere master
+            nw = p->ww * p->mfact;
+            nh = (p->wh - my) * (c[i].cfact / mfacts);
+            nx = p->wx;
+            ny = p->wy + my;
+            my += nh;
+            mfacts -= c[i].cfact;
+        } else if (n > 1 && i < n - 1) {
+            // stack
+            if ((i - p->nmaster) % 2)
+                nw *= (c[i].cfact / 2);
+            else
+                nh *= (c[i].cfact / 2);
+        }
+        place(p, &c[i], &r[i], n, nx, ny, nw - 2 * c[i].bw, nh - 2 * c[i].bw, 0);
+        if ((i - p->nmaster) % 2) {
+            nx += nw;
+            nw = ow - nw;
+        } else {
+            ny += nh;
+            nh = oh - nh;
+        }
+    }
+}
+
+void monoclerects(const TileParams* p, const TileClient* c, TileRect* r, unsigned int n) {
+    unsigned int i;
+
+    for (i = 0; i < n; i++)
+        place(p, &c[i], &r[i], n, p->wx, p->wy, p->ww - 2 * c[i].bw, p->wh - 2 * c[i].bw, 1);
+}
+
+void deckrects(const TileParams* p, const TileClient* c, TileRect* r, unsigned int n) {
+    unsigned int i, h, mw, my;
+    float mfacts = 0;
+
+    if (n == 0)
+        return;
+    for (i = 0; i < n && i < p->nmaster; i++)
+        mfacts += c[i].cfact;
+
+    if (n > p->nmaster)
+        mw = p->nmaster ? p->ww * p->mfact : 0;
+    else
+        mw = p->ww;
+    for (i = my = 0; i < n; i++) {
+        if (i < p->nmaster) {
+            h = (p->wh - my) * (c[i].cfact / mfacts);
+            place(p, &c[i], &r[i], n, p->wx, p->wy + my, mw - (2 * c[i].bw), h - (2 * c[i].bw), 0);
+            if (my + RHEIGHT(p, &r[i], &c[i]) < p->wh)
+                my += RHEIGHT(p, &r[i], &c[i]);
+            mfacts -= c[i].cfact;
+        } else
+            place(p, &c[i], &r[i], n, p->wx + mw, p->wy, p->ww - mw - (2 * c[i].bw), p->wh - (2 * c[i].bw), 0);
+    }
+}
+
+/* columns side by side in the window area, mfact 0.5 gives two */
+unsigned int scrollcolumns(const TileParams* p) {
+    int cols = 1 / p->mfact + 0.5;
+
+    return MAX(1, cols);
+}
+
+/* Every client is a column as high as the window area, on a strip going
+ * right from wx past the end of the window area. */
+void scrollrects(const TileParams* p, const TileClient* c, TileRect* r, unsigned int n) {
+    unsigned int i;
+    int cw = p->ww / scrollcolumns(p);
+
+    for (i = 0; i < n; i++)
+        fit(p, &c[i], &r[i], n, p->wx + i * cw, p->wy, MAX(1, cw - 2 * c[i].bw), MAX(1, p->wh - 2 * c[i].bw), 0);
+}
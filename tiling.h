@@ -0,0 +1,42 @@
+#ifndef TILING_H
+#define TILING_H
+
+/* The tiling layouts as pure functions: from the window area and the tiled
+ * clients of a monitor, in order, to where each of them goes. Nothing here
+ * talks to the server, layouts.c feeds them from a Monitor and bench/ runs
+ * them without one. */
+
+typedef struct {
+    float cfact;
+    int bw;
+    int basew, baseh, incw, inch, maxw, maxh, minw, minh; /* size hints */
+    float mina, maxa;
+} TileClient;
+
+typedef struct {
+    int x, y, w, h;
+    int bw; /* border width, 0 where the layout drops it */
+} TileRect;
+
+typedef struct {
+    int mw, mh; /* screen size */
+    int wx, wy, ww, wh; /* window area */
+    float mfact;
+    int nmaster;
+    int gappx, borderpx;
+    int minsize; /* smallest width and height, the bar height in dwm */
+    int sizehints; /* respect size hints, resizehints in dwm */
+} TileParams;
+
+typedef void (*TileFunc)(const TileParams* p, const TileClient* c, TileRect* r, unsigned int n);
+
+void tilerects(const TileParams* p, const TileClient* c, TileRect* r, unsigned int n);
+void centeredmasterrects(const TileParams* p, const TileClient* c, TileRect* r, unsigned int n);
+void centeredfloatingmasterrects(const TileParams* p, const TileClient* c, TileRect* r, unsigned int n);
+void dwindlerects(const TileParams* p, const TileClient* c, TileRect* r, unsigned int n);
+void monoclerects(const TileParams* p, const TileClient* c, TileRect* r, unsigned int n);
+void deckrects(const TileParams* p, const TileClient* c, TileRect* r, unsigned int n);
+void scrollrects(const TileParams* p, const TileClient* c, TileRect* r, unsigned int n);
+unsigned int scrollcolumns(const TileParams* p);
+
+#endif
@@ -0,0 +1,98 @@
+/* Open addressing hash table keyed by Window.
+ *
+ * Linear probing over a power of two sized table which is kept at most half
+ * full. Removal shifts the following entries of the probe run back instead of
+ * leaving tombstones, so lookups never degrade after many manage/unmanage
+ * cycles. An empty slot is marked by win == None. */
+
+#include "winmap.h"
+#include "util.h"
+
+#define WINMAP_MINSIZE 64
+
+static WinEntry* table;
+static size_t size, used;
+
+static size_t home(Window w) {
+    /* fibonacci hashing, XIDs of one X client only differ in the low bits */
+    return (size_t)((w * 0x9E3779B97F4A7C15ull) >> 32) & (size - 1);
+}
+
+static WinEntry* lookup(Window w) {
+    size_t i;
+
+    if (!table || w == None)
+        return NULL;
+    for (i = home(w); table[i].win != None; i = (i + 1) & (size - 1))
+        if (table[i].win == w)
+            return &table[i];
+    return NULL;
+}
+
+static void grow(void) {
+    WinEntry* old = table;
+    size_t i, j, oldsize = size;
+
+    size  = size ? size * 2 : WINMAP_MINSIZE;
+    table = ecalloc(size, sizeof(WinEntry));
+    for (i = 0; i < oldsize; i++) {
+        if (old[i].win == None)
+            continue;
+        for (j = home(old[i].win); table[j].win != None; j = (j + 1) & (size - 1))
+            ;
+        table[j] = old[i];
+    }
+    free(old);
+}
+
+void winmap_add(Window w, Client* c, Monitor* m) {
+    WinEntry* e;
+    size_t i;
+
+    if (w == None)
+        return;
+    if (!(e = lookup(w))) {
+        if (2 * (used + 1) > size)
+            grow();
+        for (i = home(w); table[i].win != None; i = (i + 1) & (size - 1))
+            ;
+        e      = &table[i];
+        e->win = w;
+        used++;
+    }
+    e->c = c;
+    e->m = m;
+}
+
+void winmap_remove(Window w) {
+    WinEntry* e;
+    size_t i, j, k;
+
+    if (!(e = lookup(w)))
+        return;
+    used--;
+    i = e - table;
+    for (;;) {
+        table[i].win = None;
+        for (j = (i + 1) & (size - 1);; j = (j + 1) & (size - 1)) {
+            if (table[j].win == None)
+                return;
+            k = home(table[j].win);
+            /* entry j may only move back if its home slot is not in (i, j] */
+            if (i <= j ? (k <= i || k > j) : (k <= i && k > j))
+                break;
+        }
+        table[i] = table[j];
+        i        = j;
+    }
+}
+
+WinEntry* winmap_find(Window w) {
+    return lookup(w);
+}
+
+void winmap_free(void) {
+    free(table);
+    table = NULL;
+    size = used = 0;
+}
@@ -0,0 +1,21 @@
+#ifndef WINMAP_H
+#define WINMAP_H
+
+#include <X11/Xlib.h>
+
+typedef struct Client Client;
+typedef struct Monitor Monitor;
+
+/* Window -> owner index, covers client windows and bar windows */
+typedef struct {
+    Window win;
+    Client* c; /* client managing win, or NULL */
+    Monitor* m; /* monitor whose bar is win, or NULL */
+} WinEntry;
+
+void winmap_add(Window w, Client* c, Monitor* m);
+void winmap_remove(Window w);
+WinEntry* winmap_find(Window w);
+void winmap_free(void);
+
+#endif